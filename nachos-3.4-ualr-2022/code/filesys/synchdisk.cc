@@ -10,12 +10,23 @@
 //	handle one operation at a time, use a lock to enforce mutual
 //	exclusion.
 //
+//	In front of the disk is a cache of sectors, described in
+//	synchdisk.h.  The same lock protects it, so a thread that misses
+//	in the cache holds the lock while it waits for the disk; since
+//	the disk does one request at a time anyway, little is lost.
+//
 // Copyright (c) 1992-1993 The Regents of the University of California.
 // All rights reserved.  See copyright.h for copyright notice and limitation 
 // of liability and disclaimer of warranty provisions.
 
 #include "copyright.h"
 #include "synchdisk.h"
+#include "system.h"
+#include "sysdep.h"
+
+#define DiskMagicSize	sizeof(int)	// the UNIX file holding the disk
+					// starts with a magic number (see
+					// disk.cc), then the sectors in order
 
 //----------------------------------------------------------------------
 // DiskRequestDone
@@ -45,17 +56,51 @@ SynchDisk::SynchDisk(const char* name)
     semaphore = new Semaphore("synch disk", 0);
     lock = new Lock("synch disk lock");
     disk = new Disk(name, DiskRequestDone, (_int) this);
+    diskName = new char[strlen(name) + 1];
+    strcpy(diskName, name);
+
+    for (int i = 0; i < CacheBuckets; i++)
+	buckets[i] = NULL;
+    mru = lru = NULL;
+    for (int i = 0; i < CacheSectors; i++) {	// all free, in LRU order
+	cache[i].sector = -1;
+	cache[i].dirty = FALSE;
+	cache[i].hashNext = NULL;
+	cache[i].prev = lru;
+	cache[i].next = NULL;
+	if (lru == NULL)
+	    mru = &cache[i];
+	else
+	    lru->next = &cache[i];
+	lru = &cache[i];
+    }
+    lastFlush = 0;
+    hits = misses = writeBacks = 0;
+    aheadFirst = aheadCount = 0;
+    pending = NULL;
+    pendingDone = FALSE;
+    readAheads = 0;
 }
 
 //----------------------------------------------------------------------
 // SynchDisk::~SynchDisk
 // 	De-allocate data structures needed for the synchronous disk
-//	abstraction.
+//	abstraction, first writing back what is in the cache.
+//
+//	This is called from Cleanup, as Nachos halts -- often from the
+//	idle loop, once the last thread has finished -- so it must not
+//	wait for the disk, or for the lock.  Any read-ahead still at the
+//	disk is abandoned (the data is only wanted in the cache, which is
+//	going away), and the dirty sectors are written by WriteThrough.
 //----------------------------------------------------------------------
 
 SynchDisk::~SynchDisk()
 {
     delete disk;
+    WriteThrough();			// don't lose what is in the cache
+    DEBUG('f', "Buffer cache: hits %d, misses %d, write-backs %d, "
+	"read-aheads %d\n", hits, misses, writeBacks, readAheads);
+    delete [] diskName;
     delete lock;
     delete semaphore;
 }
@@ -63,7 +108,9 @@ SynchDisk::~SynchDisk()
 //----------------------------------------------------------------------
 // SynchDisk::ReadSector
 // 	Read the contents of a disk sector into a buffer.  Return only
-//	after the data has been read.
+//	after the data has been read -- from the cache, if the sector is
+//	there, or else from the disk, into the cache.  If the sector is
+//	being read ahead, wait for that to finish.
 //
 //	"sectorNumber" -- the disk sector to read
 //	"data" -- the buffer to hold the contents of the disk sector
@@ -72,16 +119,32 @@ SynchDisk::~SynchDisk()
 void
 SynchDisk::ReadSector(int sectorNumber, char* data)
 {
+    CacheEntry *entry;
+
     lock->Acquire();			// only one disk I/O at a time
-    disk->ReadRequest(sectorNumber, data);
-    semaphore->P();			// wait for interrupt
+    if ((entry = Lookup(sectorNumber)) != NULL) {
+	hits++;
+	if (entry == pending)
+	    FinishReadAhead(TRUE);
+    } else {
+	misses++;
+	entry = Allocate(sectorNumber);
+	DiskRead(sectorNumber, entry->data);
+    }
+    Touch(entry);
+    bcopy(entry->data, data, SectorSize);
+    if (stats->totalTicks - lastFlush >= CacheFlushTicks)
+	FlushCache();
+    FinishReadAhead(FALSE);
+    StartReadAhead();
     lock->Release();
 }
 
 //----------------------------------------------------------------------
 // SynchDisk::WriteSector
-// 	Write the contents of a buffer into a disk sector.  Return only
-//	after the data has been written.
+// 	Write the contents of a buffer into a disk sector.  The sector
+//	goes into the cache, to be written back to the disk later; but
+//	as far as anyone reading it is concerned, it has been written.
 //
 //	"sectorNumber" -- the disk sector to be written
 //	"data" -- the new contents of the disk sector
@@ -90,20 +153,258 @@ SynchDisk::ReadSector(int sectorNumber, char* data)
 void
 SynchDisk::WriteSector(int sectorNumber, char* data)
 {
-    lock->Acquire();			// only one disk I/O at a time
+    CacheEntry *entry;
+
+    lock->Acquire();
+    if ((entry = Lookup(sectorNumber)) != NULL) {
+	hits++;
+	if (entry == pending)		// don't let the read overwrite it
+	    FinishReadAhead(TRUE);
+    } else {
+	misses++;			// no need to read it: it's all new
+	entry = Allocate(sectorNumber);
+    }
+    Touch(entry);
+    bcopy(data, entry->data, SectorSize);
+    entry->dirty = TRUE;
+    if (stats->totalTicks - lastFlush >= CacheFlushTicks)
+	FlushCache();
+    FinishReadAhead(FALSE);
+    StartReadAhead();
+    lock->Release();
+}
+
+//----------------------------------------------------------------------
+// SynchDisk::Flush
+// 	Write every dirty sector in the cache back to the disk, so that
+//	the disk is up to date.  FlushCache does the work, for a caller
+//	that already holds the lock.
+//----------------------------------------------------------------------
+
+void
+SynchDisk::Flush()
+{
+    lock->Acquire();
+    FlushCache();
+    lock->Release();
+}
+
+void
+SynchDisk::FlushCache()
+{
+    for (CacheEntry *entry = mru; entry != NULL; entry = entry->next)
+	if (entry->dirty) {
+	    DiskWrite(entry->sector, entry->data);
+	    entry->dirty = FALSE;
+	    writeBacks++;
+	}
+    lastFlush = stats->totalTicks;
+}
+
+//----------------------------------------------------------------------
+// SynchDisk::WriteThrough
+// 	Write every dirty sector in the cache straight to the UNIX file
+//	that holds the disk, the way the disk itself would, but without
+//	an interrupt to wait for.  Only for shutdown, once the disk is
+//	deleted: the disk's own file descriptor is closed by then, and no
+//	thread is left to use the cache.
+//----------------------------------------------------------------------
+
+void
+SynchDisk::WriteThrough()
+{
+    int fd = -1;
+
+    for (CacheEntry *entry = mru; entry != NULL; entry = entry->next)
+	if (entry->dirty) {
+	    if (fd < 0)
+		fd = OpenForReadWrite(diskName, TRUE);
+	    Lseek(fd, SectorSize * entry->sector + DiskMagicSize, 0);
+	    WriteFile(fd, entry->data, SectorSize);
+	    entry->dirty = FALSE;
+	    writeBacks++;
+	}
+    if (fd >= 0)
+	Close(fd);
+}
+
+//----------------------------------------------------------------------
+// SynchDisk::ReadAhead
+// 	Ask for "sectorNumber" to be read into the cache, without waiting
+//	for it.  It is put in the queue, unless it is already cached, or
+//	the queue is full; and if the disk is idle, the next read-ahead
+//	is started.
+//
+//	"sectorNumber" -- the disk sector that will be wanted soon
+//----------------------------------------------------------------------
+
+void
+SynchDisk::ReadAhead(int sectorNumber)
+{
+    lock->Acquire();
+    if (Lookup(sectorNumber) == NULL && aheadCount < ReadAheadMax) {
+	aheadQueue[(aheadFirst + aheadCount) % ReadAheadMax] = sectorNumber;
+	aheadCount++;
+    }
+    FinishReadAhead(FALSE);
+    StartReadAhead();
+    lock->Release();
+}
+
+//----------------------------------------------------------------------
+// SynchDisk::StartReadAhead
+// 	If no read-ahead is at the disk, start the next one in the queue
+//	that isn't cached by now: take a cache entry for it, and ask the
+//	disk to read into it, but don't wait.  The caller holds the lock.
+//----------------------------------------------------------------------
+
+void
+SynchDisk::StartReadAhead()
+{
+    CacheEntry *entry;
+    int sectorNumber;
+
+    while (pending == NULL && aheadCount > 0) {
+	sectorNumber = aheadQueue[aheadFirst];
+	aheadFirst = (aheadFirst + 1) % ReadAheadMax;
+	aheadCount--;
+	if (Lookup(sectorNumber) != NULL)
+	    continue;			// read since it was queued
+	entry = Allocate(sectorNumber);
+	Touch(entry);
+	pending = entry;
+	pendingDone = FALSE;
+	readAheads++;
+	disk->ReadRequest(sectorNumber, entry->data);
+    }
+}
+
+//----------------------------------------------------------------------
+// SynchDisk::FinishReadAhead
+// 	If a read-ahead is at the disk, and it has finished -- or if
+//	"wait", once it has -- take the disk's signal that it is done,
+//	so that the disk can be used again.  The caller holds the lock.
+//----------------------------------------------------------------------
+
+void
+SynchDisk::FinishReadAhead(bool wait)
+{
+    if (pending == NULL || (!pendingDone && !wait))
+	return;
+    semaphore->P();			// wait for interrupt, if need be
+    pending = NULL;
+    pendingDone = FALSE;
+}
+
+//----------------------------------------------------------------------
+// SynchDisk::DiskRead, SynchDisk::DiskWrite
+// 	Read or write a sector on the disk itself, waiting until it is
+//	done -- and, first, until any read-ahead is done, since the disk
+//	does one thing at a time.  The caller holds the lock.
+//----------------------------------------------------------------------
+
+void
+SynchDisk::DiskRead(int sectorNumber, char* data)
+{
+    FinishReadAhead(TRUE);
+    disk->ReadRequest(sectorNumber, data);
+    semaphore->P();			// wait for interrupt
+}
+
+void
+SynchDisk::DiskWrite(int sectorNumber, char* data)
+{
+    FinishReadAhead(TRUE);
     disk->WriteRequest(sectorNumber, data);
     semaphore->P();			// wait for interrupt
-    lock->Release();
+}
+
+//----------------------------------------------------------------------
+// SynchDisk::Lookup
+// 	Return the cache entry holding "sectorNumber", or NULL if it is
+//	not in the cache.
+//----------------------------------------------------------------------
+
+CacheEntry *
+SynchDisk::Lookup(int sectorNumber)
+{
+    CacheEntry *entry;
+
+    for (entry = buckets[sectorNumber % CacheBuckets]; entry != NULL;
+						entry = entry->hashNext)
+	if (entry->sector == sectorNumber)
+	    return entry;
+    return NULL;
+}
+
+//----------------------------------------------------------------------
+// SynchDisk::Allocate
+// 	Take the least recently used cache entry for "sectorNumber",
+//	which is not in the cache.  If the entry holds a dirty sector,
+//	write it back first.  The entry's contents are left as they are,
+//	for the caller to fill in.
+//----------------------------------------------------------------------
+
+CacheEntry *
+SynchDisk::Allocate(int sectorNumber)
+{
+    CacheEntry *entry;
+    CacheEntry **prev;
+
+    if (lru == pending)			// don't take it while it is read
+	FinishReadAhead(TRUE);
+    entry = lru;
+
+    if (entry->sector >= 0) {		// evict the old sector
+	if (entry->dirty) {
+	    DiskWrite(entry->sector, entry->data);
+	    entry->dirty = FALSE;
+	    writeBacks++;
+	}
+	for (prev = &buckets[entry->sector % CacheBuckets]; *prev != entry;
+						prev = &(*prev)->hashNext)
+	    ;
+	*prev = entry->hashNext;
+    }
+    entry->sector = sectorNumber;
+    entry->hashNext = buckets[sectorNumber % CacheBuckets];
+    buckets[sectorNumber % CacheBuckets] = entry;
+    return entry;
+}
+
+//----------------------------------------------------------------------
+// SynchDisk::Touch
+// 	Move "entry" to the front of the LRU list, since it has just
+//	been used.
+//----------------------------------------------------------------------
+
+void
+SynchDisk::Touch(CacheEntry *entry)
+{
+    if (entry == mru)
+	return;
+    entry->prev->next = entry->next;	// unlink it
+    if (entry->next != NULL)
+	entry->next->prev = entry->prev;
+    else
+	lru = entry->prev;
+    entry->prev = NULL;			// put it at the front
+    entry->next = mru;
+    mru->prev = entry;
+    mru = entry;
 }
 
 //----------------------------------------------------------------------
 // SynchDisk::RequestDone
 // 	Disk interrupt handler.  Wake up any thread waiting for the disk
-//	request to finish.
+//	request to finish.  If it was a read-ahead, no one may be waiting;
+//	note that it is done, so the next thread to use the disk knows.
 //----------------------------------------------------------------------
 
 void
 SynchDisk::RequestDone()
 { 
+    if (pending != NULL)		// it was a read-ahead
+	pendingDone = TRUE;
     semaphore->V();
 }
@@ -2,6 +2,26 @@
 // 	Data structures to export a synchronous interface to the raw 
 //	disk device.
 //
+//	The synchronous disk also keeps a write-back cache of recently
+//	used sectors, so that the sectors the file system reads over and
+//	over -- the free map and directory headers, the directory, the
+//	headers of open files -- usually come from memory rather than
+//	costing a seek and a rotation each time.  Written sectors stay
+//	in the cache, marked dirty, until they are evicted, or until
+//	they are flushed: by the first read or write once CacheFlushTicks
+//	have gone by since the last flush, and when the disk is deleted
+//	at shutdown.  Until then, the disk itself may be out of date; so
+//	a crash (or ^C) can lose recent writes.
+//
+//	A file being read sequentially can also ask for the sectors it
+//	will want next to be read ahead, into the cache.  Read-ahead is
+//	asynchronous: the request is started, and the caller goes on
+//	without waiting for it.  Only one request can be at the disk at a
+//	time, so the sectors to read ahead wait in a queue; the next one
+//	is started whenever a thread using the disk finds it idle.  A
+//	thread that needs the disk, or the sector being read ahead, waits
+//	for that read to finish first.
+//
 // Copyright (c) 1992-1993 The Regents of the University of California.
 // All rights reserved.  See copyright.h for copyright notice and limitation 
 // of liability and disclaimer of warranty provisions.
@@ -14,6 +34,21 @@
 #include "disk.h"
 #include "synch.h"
 
+#define CacheSectors	64	// # of sectors kept in the cache
+#define CacheBuckets	64	// # of hash chains, to find them by number
+#define CacheFlushTicks	100000	// how long a write may go unflushed
+#define ReadAheadMax	16	// # of sectors waiting to be read ahead
+
+// A sector in the cache.
+class CacheEntry {
+  public:
+    int sector;				// which one, or -1 if the entry is free
+    bool dirty;				// modified since it was read or flushed?
+    char data[SectorSize];
+    CacheEntry *hashNext;		// next in the same hash chain
+    CacheEntry *prev, *next;		// neighbours in LRU order
+};
+
 // The following class defines a "synchronous" disk abstraction.
 // As with other I/O devices, the raw physical disk is an asynchronous device --
 // requests to read or write portions of the disk return immediately,
@@ -38,16 +73,52 @@ class SynchDisk {
 					// then wait until the request is done.
     void WriteSector(int sectorNumber, char* data);
     
+    void Flush();			// Write every modified sector in the
+					// cache back to the disk.
+
+    void ReadAhead(int sectorNumber);	// Start reading a sector into the
+					// cache, if it isn't there, without
+					// waiting for it
+
     void RequestDone();			// Called by the disk device interrupt
 					// handler, to signal that the
 					// current disk operation is complete.
 
   private:
     Disk *disk;		  		// Raw disk device
+    char *diskName;			// the UNIX file it is kept in
     Semaphore *semaphore; 		// To synchronize requesting thread 
 					// with the interrupt handler
     Lock *lock;		  		// Only one read/write request
-					// can be sent to the disk at a time
+					// can be sent to the disk at a time,
+					// and only one thread at a time can
+					// use the cache
+
+    CacheEntry cache[CacheSectors];
+    CacheEntry *buckets[CacheBuckets];	// hash chains, by sector number
+    CacheEntry *mru, *lru;		// most and least recently used
+    int lastFlush;			// when the cache was last flushed
+    int hits, misses, writeBacks;	// cache performance
+
+    int aheadQueue[ReadAheadMax];	// sectors waiting to be read ahead,
+    int aheadFirst, aheadCount;		// as a circular queue
+    CacheEntry *pending;		// the entry being read ahead into,
+					// or NULL
+    bool pendingDone;			// has that read finished?
+    int readAheads;			// # of sectors read ahead
+
+    void DiskRead(int sectorNumber, char* data);  // raw disk I/O, waiting
+    void DiskWrite(int sectorNumber, char* data); // until it is done
+    CacheEntry *Lookup(int sectorNumber);	// find a cached sector
+    CacheEntry *Allocate(int sectorNumber);	// make room for one
+    void Touch(CacheEntry *entry);	// move to the front of the LRU list
+    void FlushCache();			// Flush, with the lock held
+    void WriteThrough();		// Flush at shutdown, straight to the
+					// UNIX file, without waiting
+    void StartReadAhead();		// start the next read-ahead, if the
+					// disk is idle
+    void FinishReadAhead(bool wait);	// finish the read-ahead, if it is
+					// done, or if "wait", once it is
 };
 
 #endif // SYNCHDISK_H
@@ -178,6 +178,25 @@ Scheduler::FlushPriority()
 
 // =======================================(8)============================================
 
+//----------------------------------------------------------------------
+// Scheduler::Resort
+// 	Put the ready list back in priority order, after the priority of
+//	a thread on it has been changed (for instance, when a thread
+//	waiting for a lock donates its priority to the lock holder).
+//	Threads of equal priority keep their order.
+//----------------------------------------------------------------------
+
+void
+Scheduler::Resort()
+{
+    List *sorted = new List;
+    Thread *thread;
+
+    while ((thread = (Thread *)readyList->Remove()) != NULL)
+	sorted->SortedInsert((void *)thread, thread->getPriority());
+    delete readyList;
+    readyList = sorted;
+}
 
 //----------------------------------------------------------------------
 // Scheduler::Print
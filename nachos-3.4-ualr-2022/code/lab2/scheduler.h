@@ -30,6 +30,8 @@ class Scheduler {
     
 // =======================================(5)============================================ 
     void FlushPriority();
+    void Resort();			// Re-sort the ready list, after
+					// priorities have changed
     int GetLastSwitchTick(){return lastSwitchTick;}
   private:
     int lastSwitchTick;
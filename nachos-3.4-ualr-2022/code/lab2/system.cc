@@ -7,6 +7,8 @@
 
 #include "copyright.h"
 #include "system.h"
+#include "synchstats.h"
+#include "lockcheck.h"
 
 // This defines *all* of the global data structures used by Nachos.
 // These are all initialized and de-allocated by this file.
@@ -16,6 +18,7 @@ Thread *threadToBeDestroyed;  		// the thread that just finished
 Scheduler *scheduler;			// the ready list
 Interrupt *interrupt;			// interrupt status
 Statistics *stats;			// performance metrics
+Alarm *alarmClock;			// wakes up sleeping threads
 Timer *timer;				// the hardware timer device,
 					// for invoking context switches
 
@@ -36,6 +39,9 @@ PostOffice *postOffice;
 #endif
 
 
+static char *synchProfileFile = NULL;	// where to print the counts
+					// kept by "-lp"
+
 // External definition, to allow us to take a pointer to this function
 extern void Cleanup();
 
@@ -108,7 +114,14 @@ Initialize(int argc, char **argv)
 						// number generator
 	    randomYield = TRUE;
 	    argCount = 2;
-	}
+	} else if (!strcmp(*argv, "-lp")) {
+	    synchProfiling = TRUE;		// profile synchronization
+	    if (argc > 1 && **(argv + 1) != '-') {
+		synchProfileFile = *(argv + 1);
+		argCount = 2;
+	    }
+	} else if (!strcmp(*argv, "-lc"))
+	    lockChecking = TRUE;		// look for deadlocks
 #ifdef USER_PROGRAM
 	if (!strcmp(*argv, "-s"))
 	    debugUserProg = TRUE;
@@ -138,6 +151,7 @@ Initialize(int argc, char **argv)
     stats = new Statistics();			// collect statistics
     interrupt = new Interrupt;			// start up interrupt handling
     scheduler = new Scheduler();		// initialize the ready queue
+    alarmClock = new Alarm;			// ... and the sleep queue
 
 // =======================================(3)============================================
 #ifdef AGING
@@ -184,6 +198,8 @@ void
 Cleanup()
 {
     printf("\nCleaning up...\n");
+    if (synchProfiling)
+	SynchStatsPrint(synchProfileFile);
 #ifdef NETWORK
     delete postOffice;
 #endif
@@ -201,6 +217,7 @@ Cleanup()
 #endif
     
     delete timer;
+    delete alarmClock;
     delete scheduler;
     delete interrupt;
     
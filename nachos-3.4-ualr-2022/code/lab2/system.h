@@ -15,6 +15,7 @@
 #include "interrupt.h"
 #include "stats.h"
 #include "timer.h"
+#include "alarm.h"
 
 // =======================================(2)============================================
 #define MAX_PRIORITY 99 //最大优先级
@@ -36,6 +37,7 @@ extern Scheduler *scheduler;			// the ready list
 extern Interrupt *interrupt;			// interrupt status
 extern Statistics *stats;			// performance metrics
 extern Timer *timer;				// the hardware alarm clock
+extern Alarm *alarmClock;			// wakes up sleeping threads
 
 
 #ifdef USER_PROGRAM
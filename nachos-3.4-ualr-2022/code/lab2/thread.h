@@ -46,6 +46,10 @@
 #include "addrspace.h"
 #endif
 
+#ifdef PRIORITY_INHERIT
+class Lock;
+#endif
+
 
 // CPU register state to be saved on context switch.  
 // The SPARC and MIPS only need 10 registers, but the Snake needs 18.
@@ -57,6 +61,10 @@
 // WATCH OUT IF THIS ISN'T BIG ENOUGH!!!!!
 #define StackSize	(sizeof(_int) * 1024)	// in words
 
+// Number of freed stacks kept around for reuse by later Forks, instead
+// of handing them back to the host (see Thread::StackAllocate).
+#define StackPoolSize	16
+
 
 // Thread state
 enum ThreadStatus { JUST_CREATED, RUNNING, READY, BLOCKED };
@@ -100,13 +108,20 @@ class Thread {
     
     void CheckOverflow();   			// Check if thread has 
 						// overflowed its stack
+    void SetStackSize(int words);		// Use a stack of "words" words
+						// instead of StackSize; call
+						// before Fork
     void setStatus(ThreadStatus st) { status = st; }
     char* getName() { return (name); }
     void Print() { printf("%s, ", name); }
     
 // =======================================(4)============================================ 
     ThreadStatus getStatus(){ return status; }
+#ifdef PRIORITY_INHERIT
+    void setPriority(int p){ basePriority += p - priority; priority = p; } 
+#else
     void setPriority(int p){ priority = p; } 
+#endif
 // =======================================(4)============================================
 
 // =======================================1.实现带有优先级的线程============================================
@@ -116,6 +131,16 @@ class Thread {
     }
   private:
     int priority;//优先级变量
+
+#ifdef PRIORITY_INHERIT
+// While the thread holds a lock that a more important thread is waiting
+// for, "priority" is better than "basePriority"; see Lock in synch.h.
+// setPriority moves both by the same amount, so aging still applies.
+    friend class Lock;
+    int basePriority;			// priority before any donation
+    Lock *heldLocks;			// locks held, chained by nextHeld
+    Lock *waitingFor;			// lock we are waiting for, if any
+#endif
 // =======================================1.实现带有优先级的线程============================================
     
     // some of the private data for this class is listed above
@@ -123,6 +148,7 @@ class Thread {
     int* stack; 	 		// Bottom of the stack 
 					// NULL if this is the main thread
 					// (If NULL, don't deallocate stack)
+    int stackSize;			// size of "stack", in words
     ThreadStatus status;		// ready, running or blocked
     char* name;
 
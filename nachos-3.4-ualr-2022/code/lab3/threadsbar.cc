@@ -21,11 +21,7 @@ Thread *threads[N_THREADS];
 char threads_name[N_THREADS][MAX_NAME];
 
 
-Semaphore *mutex;//互斥信号
-Semaphore *barrier;//屏障信号量
-Semaphore *s;//用于增加上下文切换的信号量
-
-int count;
+Barrier *barrier;//屏障
 
 
 void MakeTicks(int n)  // 进行了n个模拟时间
@@ -38,11 +34,7 @@ void MakeTicks(int n)  // 进行了n个模拟时间
 //   }
     //linux的sleep函数
 //   sleep(n);
-     s = new Semaphore("s", 1);
-     for(int i=n;i>0;i--){
-         s->P();
-         s->V();
-     }
+     alarmClock->WaitUntil(n);
 
    //...
 }
@@ -54,18 +46,10 @@ void BarThread(_int which)
     printf("Thread %d rendezvous\n", which);
 
     //...
-    mutex->P();
-
-    count = count + 1;
-    if(count == N_THREADS){
+    //最后到达的线程一次唤醒所有等待的线程
+    if(barrier->Wait()){
         printf("Thread %d is the last\n", which);
-        barrier->V();
     }
-
-    mutex->V();
-
-    barrier->P();
-    barrier->V();
     //...
 
     printf("Thread %d critical point\n", which);
@@ -75,11 +59,8 @@ void BarThread(_int which)
 void ThreadsBarrier()
 {
     //...
-    //初始化信号量
-    mutex = new Semaphore("mutex", 1);
-    barrier = new Semaphore("barrier", 0);
-
-    count = 0;
+    //初始化屏障
+    barrier = new Barrier("barrier", N_THREADS);
     //...
 
     // 创建并分叉N_THEADS线程
@@ -8,7 +8,7 @@
 //
 // 	Most of this file is not needed until later assignments.
 //
-// Usage: nachos -d <debugflags> -rs <random seed #>
+// Usage: nachos -d <debugflags> -rs <random seed #> -lp [profile file] -lc
 //		-s -x <nachos file> -c <consoleIn> <consoleOut>
 //		-f -cp <unix file> <nachos file>
 //		-p <nachos file> -r <nachos file> -l -D -t
@@ -18,6 +18,9 @@
 //
 //    -d causes certain debugging messages to be printed (cf. utility.h)
 //    -rs causes Yield to occur at random (but repeatable) spots
+//    -lp profiles locks, semaphores and condition variables, printing
+//	the counts (to the file, if given) when Nachos halts
+//    -lc reports deadlocks and locks taken in inconsistent orders
 //    -z prints the copyright message
 //
 //  USER_PROGRAM
@@ -2,12 +2,22 @@
 //	Routines to manage a bitmap -- an array of bits each of which
 //	can be either on or off.  Represented as an array of integers.
 //
+//	Searches go a word at a time, rather than a bit at a time: a word
+//	with a clear bit in it is found from the summary of full words,
+//	and the bit within the word by counting its trailing ones.  So
+//	finding a clear bit costs about the same however full the map is.
+//
+//	The free sector map is kept in memory while the file system is
+//	mounted, so we remember which words have changed since it was
+//	last written, and WriteBack writes only the sectors holding them.
+//
 // Copyright (c) 1992-1993 The Regents of the University of California.
 // All rights reserved.  See copyright.h for copyright notice and limitation 
 // of liability and disclaimer of warranty provisions.
 
 #include "copyright.h"
 #include "bitmap.h"
+#include "disk.h"
 
 //----------------------------------------------------------------------
 // BitMap::BitMap
@@ -21,9 +31,14 @@ BitMap::BitMap(int nitems)
 { 
     numBits = nitems;
     numWords = divRoundUp(numBits, BitsInWord);
+    numFullWords = divRoundUp(numWords, BitsInWord);
     map = new unsigned int[numWords];
-    for (int i = 0; i < numBits; i++) 
-        Clear(i);
+    full = new unsigned int[numFullWords];
+    for (int i = 0; i < numWords; i++) 
+        map[i] = 0;
+    Recount();
+    dirtyFirst = 0;			// none of it is on disk yet
+    dirtyLast = numWords - 1;
 }
 
 //----------------------------------------------------------------------
@@ -33,7 +48,8 @@ BitMap::BitMap(int nitems)
 
 BitMap::~BitMap()
 { 
-    delete map;
+    delete [] map;
+    delete [] full;
 }
 
 //----------------------------------------------------------------------
@@ -46,8 +62,17 @@ BitMap::~BitMap()
 void
 BitMap::Mark(int which) 
 { 
+    int w = which / BitsInWord;
+    unsigned int bit = 1 << (which % BitsInWord);
+
     ASSERT(which >= 0 && which < numBits);
-    map[which / BitsInWord] |= 1 << (which % BitsInWord);
+    if (map[w] & bit)
+	return;
+    map[w] |= bit;
+    numClear--;
+    Dirty(w);
+    if (map[w] == AllOnes)
+	full[w / BitsInWord] |= 1 << (w % BitsInWord);
 }
     
 //----------------------------------------------------------------------
@@ -60,8 +85,35 @@ BitMap::Mark(int which)
 void 
 BitMap::Clear(int which) 
 {
+    int w = which / BitsInWord;
+    unsigned int bit = 1 << (which % BitsInWord);
+
     ASSERT(which >= 0 && which < numBits);
-    map[which / BitsInWord] &= ~(1 << (which % BitsInWord));
+    if (!(map[w] & bit))
+	return;
+    map[w] &= ~bit;
+    numClear++;
+    Dirty(w);
+    full[w / BitsInWord] &= ~(1 << (w % BitsInWord));
+    if (w < hint)
+	hint = w;
+}
+
+//----------------------------------------------------------------------
+// BitMap::Dirty
+// 	Note that word "w" of the bitmap has changed since it was last
+//	written to disk.
+//----------------------------------------------------------------------
+
+void
+BitMap::Dirty(int w)
+{
+    if (dirtyFirst > dirtyLast)
+	dirtyFirst = dirtyLast = w;
+    else if (w < dirtyFirst)
+	dirtyFirst = w;
+    else if (w > dirtyLast)
+	dirtyLast = w;
 }
 
 //----------------------------------------------------------------------
@@ -88,35 +140,120 @@ BitMap::Test(int which)
 //	As a side effect, set the bit (mark it as in use).
 //	(In other words, find and allocate a bit.)
 //
+//	There are no clear bits before word "hint", so the search starts
+//	there, skipping over full words with the summary.
+//
 //	If no bits are clear, return -1.
 //----------------------------------------------------------------------
 
 int 
 BitMap::Find() 
 {
-    for (int i = 0; i < numBits; i++)
-	if (!Test(i)) {
-	    Mark(i);
-     //   printf("find:%d,\n",i);
-	    return i;
+    int s, w, which;
+
+    if (numClear == 0)
+	return -1;
+    s = hint / BitsInWord;
+    while (full[s] == AllOnes)		// there is a clear bit somewhere
+	s++;
+    w = s * BitsInWord + __builtin_ctz(~full[s]);
+    which = w * BitsInWord + __builtin_ctz(~map[w]);
+    hint = w;
+    Mark(which);
+    return which;
+}
+
+//----------------------------------------------------------------------
+// BitMap::FindContiguous
+// 	Return the number of the first of "count" clear bits in a row,
+//	all at or after "start" and before "end".  As a side effect, set
+//	them all.  (In other words, allocate a contiguous run of bits.)
+//
+//	Empty and full words are stepped over whole, and whole groups of
+//	full words by the summary; only words that are partly in use are
+//	looked at a bit at a time.
+//
+//	If there is no such run, return -1.
+//----------------------------------------------------------------------
+
+int
+BitMap::FindContiguous(int count, int start, int end)
+{
+    int run = 0, i, first;
+    unsigned int word;
+
+    if (end > numBits)
+	end = numBits;
+    if (count <= 0 || count > numClear)
+	return -1;
+    for (i = start; i < end && run < count; ) {
+	word = map[i / BitsInWord];
+	if (i % (BitsInWord * BitsInWord) == 0
+		&& i + BitsInWord * BitsInWord <= end
+		&& full[i / (BitsInWord * BitsInWord)] == AllOnes) {
+	    run = 0;
+	    i += BitsInWord * BitsInWord;
+	} else if (i % BitsInWord == 0 && i + BitsInWord <= end
+		&& (word == 0 || word == AllOnes)) {
+	    run = (word == 0) ? run + BitsInWord : 0;
+	    i += BitsInWord;
+	} else {
+	    run = (word & (1 << (i % BitsInWord))) ? 0 : run + 1;
+	    i++;
 	}
-    return -1;
+    }
+    if (run < count)
+	return -1;
+    first = i - run;
+    for (i = first; i < first + count; i++)
+	Mark(i);
+    return first;
 }
 
 //----------------------------------------------------------------------
 // BitMap::NumClear
 // 	Return the number of clear bits in the bitmap.
 //	(In other words, how many bits are unallocated?)
+//	The count is kept up to date by Mark and Clear.
 //----------------------------------------------------------------------
 
 int 
 BitMap::NumClear() 
 {
-    int count = 0;
+    return numClear;
+}
 
-    for (int i = 0; i < numBits; i++)
-	if (!Test(i)) count++;
-    return count;
+//----------------------------------------------------------------------
+// BitMap::Recount
+// 	Rebuild what we keep alongside the bits -- the summary of full
+//	words, the count of clear bits, and the hint -- from the bits
+//	themselves, after they have been set wholesale.
+//
+//	The unused bits at the end of the last word are set, and so are
+//	the summary bits of the words past the end, so that they are
+//	never found clear.
+//----------------------------------------------------------------------
+
+void
+BitMap::Recount()
+{
+    int w;
+
+    if (numBits % BitsInWord != 0)
+	map[numWords - 1] |= AllOnes << (numBits % BitsInWord);
+    numClear = 0;
+    hint = numWords;
+    for (w = 0; w < numFullWords; w++)
+	full[w] = 0;
+    for (w = 0; w < numFullWords * BitsInWord; w++) {
+	if (w >= numWords || map[w] == AllOnes) {
+	    full[w / BitsInWord] |= 1 << (w % BitsInWord);
+	    continue;
+	}
+	numClear += BitsInWord - __builtin_popcount(map[w]);
+	if (hint == numWords)
+	    hint = w;
+    }
 }
 
 //----------------------------------------------------------------------
@@ -150,11 +287,17 @@ void
 BitMap::FetchFrom(OpenFile *file) 
 {
     file->ReadAt((char *)map, numWords * sizeof(unsigned), 0);
+    Recount();
+    dirtyFirst = numWords;		// same as on disk
+    dirtyLast = -1;
 }
 
 //----------------------------------------------------------------------
 // BitMap::WriteBack
-// 	Store the contents of a bitmap to a Nachos file.
+// 	Store the contents of a bitmap to a Nachos file.  Only the
+//	sectors of the file holding words that have changed since the
+//	last FetchFrom or WriteBack are written; whole sectors, so that
+//	the file system need not read them first.
 //
 //	"file" is the place to write the bitmap to
 //----------------------------------------------------------------------
@@ -162,7 +305,17 @@ BitMap::FetchFrom(OpenFile *file)
 void
 BitMap::WriteBack(OpenFile *file)
 {   
-    
-   file->WriteAt((char *)map, numWords * sizeof(unsigned), 0);
+    int first, last, size = numWords * sizeof(unsigned);
 
+    if (dirtyFirst > dirtyLast)
+	return;				// nothing has changed
+    first = divRoundDown(dirtyFirst * sizeof(unsigned), SectorSize)
+							* SectorSize;
+    last = divRoundUp((dirtyLast + 1) * sizeof(unsigned), SectorSize)
+							* SectorSize;
+    if (last > size)
+	last = size;
+    file->WriteAt((char *)map + first, last - first, first);
+    dirtyFirst = numWords;
+    dirtyLast = -1;
 }
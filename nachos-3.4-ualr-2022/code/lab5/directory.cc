@@ -7,14 +7,22 @@
 //	of each directory entry means that we have the restriction
 //	of a fixed maximum size for file names.
 //
+//	The table is a hash table, on disk as well as in memory: a name
+//	is kept in the first free entry at or after the one its hash
+//	picks, wrapping around at the end ("linear probing").  So a
+//	lookup looks at a few entries, not all of them.  The table is
+//	kept at most 3/4 full, so that those runs of entries stay short;
+//	when it gets fuller, Resize doubles it, and the directory file
+//	grows to match when it is written back.  The size of the table
+//	is not stored; it is the length of the file.
+//
 //	The constructor initializes an empty directory of a certain size;
 //	we use ReadFrom/WriteBack to fetch the contents of the directory
 //	from disk, and to write back any modifications back to disk.
 //
-//	Also, this implementation has the restriction that the size
-//	of the directory cannot expand.  In other words, once all the
-//	entries in the directory are used, no more files can be created.
-//	Fixing this is one of the parts to the assignment.
+//	The root directory is kept in memory while the file system is
+//	mounted, so we remember which entries have changed, and WriteBack
+//	writes only the sectors holding them.
 //
 // Copyright (c) 1992-1993 The Regents of the University of California.
 // All rights reserved.  See copyright.h for copyright notice and limitation 
@@ -24,6 +32,23 @@
 #include "utility.h"
 #include "filehdr.h"
 #include "directory.h"
+#include "disk.h"
+
+//----------------------------------------------------------------------
+// Hash
+// 	Return the hash of a file name, looking at no more of it than
+//	is kept in a directory entry.
+//----------------------------------------------------------------------
+
+static unsigned int
+Hash(char *name)
+{
+    unsigned int h = 0;
+
+    for (int i = 0; i < FileNameMaxLen && name[i] != '\0'; i++)
+	h = h * 31 + (unsigned char) name[i];
+    return h;
+}
 
 //----------------------------------------------------------------------
 // Directory::Directory
@@ -37,13 +62,31 @@
 
 Directory::Directory(int size)
 {
+    table = NULL;
+    numEntries = 0;
+    NewTable(size);
+}
+
+//----------------------------------------------------------------------
+// Directory::NewTable
+// 	Replace the table with an empty one of "size" entries, none of
+//	which is on disk yet.
+//----------------------------------------------------------------------
+
+void
+Directory::NewTable(int size)
+{
+    delete [] table;
     table = new DirectoryEntry[size];
     tableSize = size;
     for (int i = 0; i < tableSize; i++)
 	{
         table[i].inUse = FALSE;
+        table[i].isDir = FALSE;
         table[i].authority=0x1FF;//start with full authority;
     }
+    dirtyFirst = 0;			// none of it is on disk yet
+    dirtyLast = tableSize - 1;
 }
 
 //----------------------------------------------------------------------
@@ -58,7 +101,8 @@ Directory::~Directory()
 
 //----------------------------------------------------------------------
 // Directory::FetchFrom
-// 	Read the contents of the directory from disk.
+// 	Read the contents of the directory from disk.  The table is
+//	made as big as the file.
 //
 //	"file" -- file containing the directory contents
 //----------------------------------------------------------------------
@@ -66,26 +110,72 @@ Directory::~Directory()
 void
 Directory::FetchFrom(OpenFile *file)
 {
+    int size = file->Length() / sizeof(DirectoryEntry);
+
+    if (size != tableSize)
+	NewTable(size);
     (void) file->ReadAt((char *)table, tableSize * sizeof(DirectoryEntry), 0);
+    numEntries = 0;
+    for (int i = 0; i < tableSize; i++)
+	if (table[i].inUse)
+	    numEntries++;
+    dirtyFirst = tableSize;		// same as on disk
+    dirtyLast = -1;
 }
 
 //----------------------------------------------------------------------
 // Directory::WriteBack
-// 	Write any modifications to the directory back to disk
+// 	Write any modifications to the directory back to disk -- the
+//	whole sectors holding the entries changed since the last
+//	FetchFrom or WriteBack.  If the table has grown, so does the
+//	file; return FALSE if there is no room on disk for that.
 //
 //	"file" -- file to contain the new directory contents
 //----------------------------------------------------------------------
 
-void
+bool
 Directory::WriteBack(OpenFile *file)
 {   
-    (void) file->WriteAt((char *)table, tableSize * sizeof(DirectoryEntry), 0);
+    int first, last, size = tableSize * sizeof(DirectoryEntry);
+
+    if (dirtyFirst > dirtyLast)
+	return TRUE;			// nothing has changed
+    first = divRoundDown(dirtyFirst * sizeof(DirectoryEntry), SectorSize)
+							* SectorSize;
+    last = divRoundUp((dirtyLast + 1) * sizeof(DirectoryEntry), SectorSize)
+							* SectorSize;
+    if (last > size)
+	last = size;
+    if (file->WriteAt((char *)table + first, last - first, first)
+							!= last - first)
+	return FALSE;
+    dirtyFirst = tableSize;
+    dirtyLast = -1;
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// Directory::Dirty
+// 	Note that entry "i" has changed since it was last written to disk.
+//----------------------------------------------------------------------
+
+void
+Directory::Dirty(int i)
+{
+    if (dirtyFirst > dirtyLast)
+	dirtyFirst = dirtyLast = i;
+    else if (i < dirtyFirst)
+	dirtyFirst = i;
+    else if (i > dirtyLast)
+	dirtyLast = i;
 }
 
 //----------------------------------------------------------------------
 // Directory::FindIndex
 // 	Look up file name in directory, and return its location in the table of
 //	directory entries.  Return -1 if the name isn't in the directory.
+//	The search starts where the name hashes to, and stops at the
+//	first free entry.
 //
 //	"name" -- the file name to look up
 //----------------------------------------------------------------------
@@ -93,12 +183,54 @@ Directory::WriteBack(OpenFile *file)
 int
 Directory::FindIndex(char *name)
 {
-    for (int i = 0; i < tableSize; i++)
-        if (table[i].inUse && !strncmp(table[i].name, name, FileNameMaxLen))
+    int i = Hash(name) % tableSize;
+
+    for (int n = 0; n < tableSize && table[i].inUse; n++) {
+        if (!strncmp(table[i].name, name, FileNameMaxLen))
 	    return i;
+	i = (i + 1) % tableSize;
+    }
     return -1;		// name not in directory
 }
 
+//----------------------------------------------------------------------
+// Directory::Crowded
+// 	Return TRUE if adding one more file would make the table more
+//	than 3/4 full, so that it ought to be made bigger first.
+//----------------------------------------------------------------------
+
+bool
+Directory::Crowded()
+{
+    return (numEntries + 1) * 4 > tableSize * 3;
+}
+
+//----------------------------------------------------------------------
+// Directory::Resize
+// 	Move the entries into a new table of "size" entries, each where
+//	its name hashes to in the new table.  All of the new table needs
+//	writing back.
+//----------------------------------------------------------------------
+
+void
+Directory::Resize(int size)
+{
+    DirectoryEntry *oldTable = table;
+    int oldSize = tableSize, i;
+
+    ASSERT(size > numEntries);
+    table = NULL;
+    NewTable(size);
+    for (int j = 0; j < oldSize; j++)
+	if (oldTable[j].inUse) {
+	    for (i = Hash(oldTable[j].name) % tableSize; table[i].inUse;
+						i = (i + 1) % tableSize)
+		;
+	    table[i] = oldTable[j];
+	}
+    delete [] oldTable;
+}
+
 //----------------------------------------------------------------------
 // Directory::Find
 // 	Look up file name in directory, and return the disk sector number
@@ -118,6 +250,22 @@ Directory::Find(char *name)
     return -1;
 }
 
+//----------------------------------------------------------------------
+// Directory::IsDir
+// 	Return TRUE if file "name" is in the directory, and is itself a
+//	directory.
+//
+//	"name" -- the file name to look up
+//----------------------------------------------------------------------
+
+bool
+Directory::IsDir(char *name)
+{
+    int i = FindIndex(name);
+
+    return i != -1 && table[i].isDir;
+}
+
 //----------------------------------------------------------------------
 // Directory::Add
 // 	Add a file into the directory.  Return TRUE if successful;
@@ -127,22 +275,29 @@ Directory::Find(char *name)
 //
 //	"name" -- the name of the file being added
 //	"newSector" -- the disk sector containing the added file's header
+//	"isDir" -- is the added file a directory?
 //----------------------------------------------------------------------
 
 bool
-Directory::Add(char *name, int newSector)
+Directory::Add(char *name, int newSector, bool isDir)
 { 
+    int i;
+
     if (FindIndex(name) != -1)
 	return FALSE;
+    if (numEntries + 1 >= tableSize)
+	return FALSE;	// no space; Resize, and try again
 
-    for (int i = 0; i < tableSize; i++)
-        if (!table[i].inUse) {
-            table[i].inUse = TRUE;
-            strncpy(table[i].name, name, FileNameMaxLen); 
-            table[i].sector = newSector;
-        return TRUE;
-	}
-    return FALSE;	// no space.  Fix when we have extensible files.
+    for (i = Hash(name) % tableSize; table[i].inUse; i = (i + 1) % tableSize)
+	;
+    table[i].inUse = TRUE;
+    strncpy(table[i].name, name, FileNameMaxLen); 
+    table[i].sector = newSector;
+    table[i].isDir = isDir;
+    table[i].authority = 0x1FF;
+    numEntries++;
+    Dirty(i);
+    return TRUE;
 }
 
 //----------------------------------------------------------------------
@@ -150,17 +305,34 @@ Directory::Add(char *name, int newSector)
 // 	Remove a file name from the directory.  Return TRUE if successful;
 //	return FALSE if the file isn't in the directory. 
 //
+//	The entries after it, up to the next free one, may have been put
+//	there because it was in use; each that would be found from its
+//	hash before the hole is moved into it, so that lookups, which
+//	stop at a free entry, still find them.
+//
 //	"name" -- the file name to be removed
 //----------------------------------------------------------------------
 
 bool
 Directory::Remove(char *name)
 { 
-    int i = FindIndex(name);
+    int i = FindIndex(name), j, home;
 
     if (i == -1)
 	return FALSE; 		// name not in directory
     table[i].inUse = FALSE;
+    numEntries--;
+    Dirty(i);
+    for (j = (i + 1) % tableSize; table[j].inUse; j = (j + 1) % tableSize) {
+	home = Hash(table[j].name) % tableSize;
+	if ((i < j) ? (home <= i || home > j) : (home <= i && home > j)) {
+	    table[i] = table[j];	// move it into the hole
+	    table[j].inUse = FALSE;
+	    Dirty(i);
+	    Dirty(j);
+	    i = j;
+	}
+    }
     return TRUE;	
 }
 
@@ -174,7 +346,7 @@ Directory::List()
 {
    for (int i = 0; i < tableSize; i++)
 	if (table[i].inUse)
-	    printf("%s\n  ", table[i].name);
+	    printf("%s%s\n  ", table[i].name, table[i].isDir ? "/" : "");
 }
 
 //----------------------------------------------------------------------
@@ -191,7 +363,8 @@ Directory::Print()
     printf("Directory contents:\n");
     for (int i = 0; i < tableSize; i++)
 	if (table[i].inUse) {
-	    printf("Name: %s, Sector: %d\n", table[i].name, table[i].sector);
+	    printf("Name: %s%s, Sector: %d\n", table[i].name,
+				table[i].isDir ? "/" : "", table[i].sector);
 	    hdr->FetchFrom(table[i].sector);
 	    hdr->Print();
 	}
@@ -219,6 +392,7 @@ void Directory::PrintTotal(){
 void Directory::setAuthority(char *name, int authority){
         int i = FindIndex(name); 
         table[i].authority=authority;
+        Dirty(i);
 }
 bool Directory::isHasAuthority(AccountEntity* user,OpenFile *accountFile, char *fileName,AuthorityKind kind){
         int i = FindIndex(fileName);
@@ -20,12 +20,14 @@
 #include "openfile.h"
 #include "account.h"
 #define  NumUsers    10
-#define FileNameMaxLen 		9	// for simplicity, we assume 
-					// file names are <= 9 characters long
+#define FileNameMaxLen 		19	// for simplicity, we assume 
+					// file names are <= 19 characters
+					// long, which makes an entry 32 bytes
 
 // The following class defines a "directory entry", representing a file
 // in the directory.  Each entry gives the name of the file, and where
-// the file's header is to be found on disk.
+// the file's header is to be found on disk.  The file may itself be a
+// directory.
 //
 // Internal data structures kept public so that Directory operations can
 // access them directly.
@@ -34,11 +36,13 @@ class DirectoryEntry {
   public:
   //1 B
     bool inUse;
-  //4 B  				// Is this directory entry in use?
+  //1 B  				// Is this directory entry in use?
+    bool isDir;				// Is the file a directory?
+  //4 B
     int sector;				// Location on disk to find the 				//   FileHeader for this file 
   //9 bit is authority  32-9=23 bits are useId
     int authority;
-  //10 B
+  //20 B
     char name[FileNameMaxLen + 1];	// Text name for file, with +1 for 
 					// the trailing '\0'
     
@@ -67,16 +71,26 @@ class Directory {
     ~Directory();			// De-allocate the directory
 
     void FetchFrom(OpenFile *file);  	// Init directory contents from disk
-    void WriteBack(OpenFile *file);	// Write modifications to 
+    bool WriteBack(OpenFile *file);	// Write modifications to 
 					// directory contents back to disk
 
     int Find(char *name);		// Find the sector number of the 
 					// FileHeader for file: "name"
 
-    bool Add(char *name, int newSector);  // Add a file name into the directory
+    bool IsDir(char *name);		// Is file "name" a directory?
+
+    bool Add(char *name, int newSector, bool isDir);
+					// Add a file name into the directory
 
     bool Remove(char *name);		// Remove a file from the directory
 
+    bool Crowded();			// Ought the table to be made bigger
+					// before adding a file?
+    void Resize(int size);		// Rehash into a table of "size"
+					// entries
+    int TableSize() { return tableSize; }
+    bool IsEmpty() { return numEntries == 0; }
+
     void List();			// Print the names of all the files
 					//  in the directory
     void Print();			// Verbose print of the contents
@@ -88,10 +102,17 @@ class Directory {
   private:
     int tableSize;			// Number of directory entries
     DirectoryEntry *table;		// Table of pairs: 
-					// <file name, file header location> 
+					// <file name, file header location>,
+					// hashed on the name
+    int numEntries;			// Number of entries in use
     FileHeader *second;
+    int dirtyFirst, dirtyLast;		// the entries changed since the
+					// table was last read or written;
+					// none if dirtyFirst > dirtyLast
     int FindIndex(char *name);		// Find the index into the directory 
 					//  table corresponding to "name"
+    void Dirty(int i);			// note that entry "i" has changed
+    void NewTable(int size);		// start over with an empty table
 };
 
 #endif // DIRECTORY_H
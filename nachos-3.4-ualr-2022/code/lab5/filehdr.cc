@@ -4,11 +4,31 @@
 //
 //	The file header is used to locate where on disk the 
 //	file's data is stored.  We implement this as a fixed size
-//	table of pointers -- each entry in the table points to the 
-//	disk sector containing that portion of the file data
-//	(in other words, there are no indirect or doubly indirect 
-//	blocks). The table size is chosen so that the file header
-//	will be just big enough to fit in one disk sector, 
+//	table of extents -- each entry in the table gives the first of
+//	a run of consecutive disk sectors holding the file data, and
+//	how many there are -- followed, for files in many pieces, by
+//	single, double and triple indirect blocks of extents, as in
+//	UNIX.  The table size is chosen so that the file header will be
+//	just big enough to fit in one disk sector.  Indirect blocks are
+//	cached in memory with the header, so that finding a sector costs
+//	disk reads only the first time.
+//
+//	Data blocks are allocated in runs of consecutive sectors,
+//	continuing from the end of the file when the sectors there are
+//	free (which just lengthens the last extent), and otherwise,
+//	where possible, within a single track.  Reading a file in order
+//	then moves the disk head along the track, so that successive
+//	sectors are found in the disk's track buffer, instead of costing
+//	a rotation (or a seek) each.
+//
+//	Data block "i" of the file is found by adding up the lengths of
+//	the extents until they pass "i".  Blocks are mostly asked for in
+//	order, so the search starts from the extent the last one was
+//	found in.  Extent "k" is found, like a block in a UNIX file, by
+//	counting off the direct extents, then the ExtentsPerBlock under
+//	the single indirect block, then the NumIndirect * ExtentsPerBlock
+//	under the double indirect block, and what is left is under the
+//	triple indirect block.
 //
 //      Unlike in a real system, we do not keep track of file permissions, 
 //	ownership, last modification date, etc., in the file header. 
@@ -29,6 +49,293 @@
 #include "filehdr.h"
 #include "filesys.h"
 
+//----------------------------------------------------------------------
+// IndexBlocks
+// 	Return how many indirect blocks a file of "numExtents" extents
+//	needs.  The extents are filled in order, so each level of each
+//	tree needs just enough blocks to cover the level below it.
+//----------------------------------------------------------------------
+
+static int
+IndexBlocks(int numExtents)
+{
+    int blocks = 0, span = ExtentsPerBlock;
+    int here, cover;
+
+    numExtents -= NumDirect;
+    for (int level = 1; level <= NumIndirectLevels && numExtents > 0;
+					level++, span *= NumIndirect) {
+        here = (numExtents < span) ? numExtents : span;
+        cover = divRoundUp(here, ExtentsPerBlock);
+        blocks += cover;
+        for (int l = 1; l < level; l++) {
+            cover = divRoundUp(cover, NumIndirect);
+            blocks += cover;
+        }
+        numExtents -= here;
+    }
+    return blocks;
+}
+
+FileHeader::FileHeader() {
+    numExtents = 0;
+    memset(extents, 0, sizeof(extents));
+    for (int l = 0; l < NumIndirectLevels; l++)
+        indirectSector[l] = -1;
+    blocks = NULL;
+    hintExtent = hintFirst = 0;
+}
+
+FileHeader::~FileHeader() {
+    IndirectBlock *block;
+
+    while ((block = blocks) != NULL) {
+        blocks = block->next;
+        delete block;
+    }
+}
+
+//----------------------------------------------------------------------
+// FileHeader::Block
+// 	Return the in-memory copy of the indirect block at "sector",
+//	reading it from disk the first time.
+//----------------------------------------------------------------------
+
+IndirectBlock *
+FileHeader::Block(int sector)
+{
+    IndirectBlock *block;
+
+    for (block = blocks; block != NULL; block = block->next)
+        if (block->sector == sector)
+            return block;
+    block = new IndirectBlock;
+    block->sector = sector;
+    synchDisk->ReadSector(sector, (char *)block->entries);
+    block->dirty = FALSE;
+    block->next = blocks;
+    blocks = block;
+    return block;
+}
+
+//----------------------------------------------------------------------
+// FileHeader::NewBlock
+// 	Start a new, empty indirect block at "sector", which has just been
+//	allocated, so there is nothing on disk worth reading.  It is
+//	written back with the header.
+//----------------------------------------------------------------------
+
+IndirectBlock *
+FileHeader::NewBlock(int sector)
+{
+    IndirectBlock *block = new IndirectBlock;
+
+    block->sector = sector;
+    memset(block->entries, 0, sizeof(block->entries));
+    block->dirty = TRUE;
+    block->next = blocks;
+    blocks = block;
+    return block;
+}
+
+//----------------------------------------------------------------------
+// FileHeader::ExtentSlot
+// 	Return where extent "k" is kept: in the header, or in an indirect
+//	block.  If "freeMap" is not NULL, the extent is about to be filled
+//	in or changed: allocate any indirect blocks that are missing on
+//	the way down, and mark the block holding it dirty.  Otherwise,
+//	return NULL if the extent isn't there.
+//----------------------------------------------------------------------
+
+Extent *
+FileHeader::ExtentSlot(int k, BitMap *freeMap)
+{
+    int level = 0, span = ExtentsPerBlock;	// extents under the root
+    int *ptr;
+    IndirectBlock *block, *parent = NULL;
+
+    if (k < NumDirect)
+        return &extents[k];
+    k -= NumDirect;
+    while (k >= span) {			// which tree is it in?
+        k -= span;
+        span *= NumIndirect;
+        if (++level == NumIndirectLevels)
+            return NULL;		// beyond the biggest file
+    }
+
+    ptr = &indirectSector[level];
+    for (;;) {
+        if (*ptr <= 0) {		// -1 in the header, 0 in a block
+            if (freeMap == NULL)
+                return NULL;
+            *ptr = freeMap->Find();
+            ASSERT(*ptr != -1);		// the caller checked for room
+            if (parent != NULL)
+                parent->dirty = TRUE;
+            block = NewBlock(*ptr);
+        } else
+            block = Block(*ptr);
+        if (span == ExtentsPerBlock) {	// it's a block of extents
+            if (freeMap != NULL)
+                block->dirty = TRUE;
+            return &block->extents[k];
+        }
+        span /= NumIndirect;		// extents under each entry
+        ptr = &block->entries[k / span];
+        k %= span;
+        parent = block;
+    }
+}
+
+//----------------------------------------------------------------------
+// FileHeader::DataSector
+// 	Return the disk sector holding data block "i" of the file.  The
+//	search starts at the extent the last block was found in, unless
+//	"i" comes before it.  The hint is kept in locals while searching,
+//	since reading an indirect block may let another thread using the
+//	same header move it.
+//----------------------------------------------------------------------
+
+int
+FileHeader::DataSector(int i)
+{
+    int k = hintExtent, first = hintFirst;
+    Extent *extent;
+
+    if (i < first) {			// start again from the beginning
+        k = 0;
+        first = 0;
+    }
+    for (;; k++) {
+        ASSERT(k < numExtents);
+        extent = ExtentSlot(k, NULL);
+        ASSERT(extent != NULL);
+        if (i < first + extent->length)
+            break;
+        first += extent->length;
+    }
+    hintExtent = k;
+    hintFirst = first;
+    return extent->start + (i - first);
+}
+
+//----------------------------------------------------------------------
+// AllocateRun
+// 	Allocate a run of consecutive free sectors, at most "want" long,
+//	for the next data blocks of a file, and return the first; set
+//	"*length" to how many there are.  In order of preference:
+//
+//	   the sectors just after the file's last one, "goal" (-1 if
+//		the file is empty), so that the file stays contiguous
+//	   a run of the whole length (or of a whole track, if "want" is
+//		bigger) within one track
+//	   the first run, anywhere, of half the length, or a quarter,
+//		..., down to one sector
+//
+//	The caller has made sure there are at least "want" free sectors.
+//----------------------------------------------------------------------
+
+static int
+AllocateRun(BitMap *freeMap, int goal, int want, int *length)
+{
+    int first, n;
+
+    if (goal >= 0 && goal < NumSectors && !freeMap->Test(goal)) {
+        for (n = 0; n < want && goal + n < NumSectors
+				&& !freeMap->Test(goal + n); n++)
+            freeMap->Mark(goal + n);
+        *length = n;
+        return goal;
+    }
+
+    n = (want < SectorsPerTrack) ? want : SectorsPerTrack;
+    for (int track = 0; track < NumSectors / SectorsPerTrack; track++) {
+        first = freeMap->FindContiguous(n, track * SectorsPerTrack,
+					(track + 1) * SectorsPerTrack);
+        if (first != -1) {
+            *length = n;
+            return first;
+        }
+    }
+
+    for (n = divRoundUp(n, 2); ; n = divRoundUp(n, 2)) {
+        first = freeMap->FindContiguous(n, 0, NumSectors);
+        if (first != -1) {
+            *length = n;
+            return first;
+        }
+        ASSERT(n > 1);			// there is a free sector somewhere
+    }
+}
+
+//----------------------------------------------------------------------
+// FileHeader::Grow
+// 	Add data blocks to the file, and the indirect blocks to find them
+//	by, until it has "numSectors" of them.  Return FALSE, allocating
+//	nothing, if the file would be too big, or there is not enough
+//	free space -- counting on each new block being an extent of its
+//	own, and needing room in the indirect blocks, which is the worst
+//	that can happen.
+//
+//	The data blocks are allocated a run at a time, by AllocateRun;
+//	any indirect blocks needed are allocated as they come up, from
+//	wherever is free.
+//----------------------------------------------------------------------
+
+bool
+FileHeader::Grow(BitMap *freeMap, int numSectors)
+{
+    int oldSectors = divRoundUp(numBytes, SectorSize);
+    int added = numSectors - oldSectors;
+    int needed, goal, first, length;
+    Extent *last;
+
+    if (numSectors > MaxFileSectors)
+        return FALSE;			// too big
+    needed = added + IndexBlocks(numExtents + added) - IndexBlocks(numExtents);
+    if (freeMap->NumClear() < needed)
+        return FALSE;			// not enough space
+    last = (numExtents > 0) ? ExtentSlot(numExtents - 1, NULL) : NULL;
+    for (int i = oldSectors; i < numSectors; i += length) {
+        goal = (last != NULL) ? last->start + last->length : -1;
+        first = AllocateRun(freeMap, goal, numSectors - i, &length);
+        if (first == goal)		// carry on the last extent
+            last = ExtentSlot(numExtents - 1, freeMap);
+        else {				// start a new one
+            ASSERT(numExtents < MaxExtents);
+            last = ExtentSlot(numExtents++, freeMap);
+            last->start = first;
+            last->length = 0;
+        }
+        last->length += length;
+    }
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// FileHeader::FreeTree
+// 	Free the indirect block at "sector", "level" levels above the
+//	blocks of extents, along with the indirect blocks under it.  The
+//	data blocks are freed by Deallocate, from the extents.
+//----------------------------------------------------------------------
+
+void
+FileHeader::FreeTree(BitMap *freeMap, int sector, int level)
+{
+    IndirectBlock *block;
+
+    if (sector <= 0)
+        return;				// not there
+    if (level > 1) {
+        block = Block(sector);
+        for (int i = 0; i < NumIndirect; i++)
+            FreeTree(freeMap, block->entries[i], level - 1);
+    }
+    ASSERT(freeMap->Test(sector));	// ought to be marked!
+    freeMap->Clear(sector);
+}
+
 //----------------------------------------------------------------------
 // FileHeader::Allocate
 // 	Initialize a fresh file header for a newly created file.
@@ -40,61 +347,28 @@
 //	"fileSize" is the bit map of free disk sectors
 //----------------------------------------------------------------------
 
-
-FileHeader::FileHeader() {
-    memset(dataSectors, 0, sizeof(dataSectors));
-    nextSectorDirectory=-1;
-}
-/// @brief 
-/// @param freeMap 
-/// @param fileSize 
-/// @return 
 bool
 FileHeader::Allocate(BitMap *freeMap, int fileSize)
-{   this->numBytes=fileSize;
-   
+{
     int numSectors  = divRoundUp(fileSize, SectorSize);
-    if (freeMap->NumClear() < numSectors)
+
+    numBytes = 0;
+    numExtents = 0;
+    if (!Grow(freeMap, numSectors))
 	return FALSE;		// not enough space
-    bool isNeedTwoIndex=0;
-    char* nextSector;
-    //judge if need second level index
-    if (numSectors>NumDirect)
-        {
-            isNeedTwoIndex=1;
-            nextSector=new char[SectorSize];
-            nextSectorDirectory=freeMap->Find();
-            synchDisk->ReadSector(nextSectorDirectory,nextSector);
-        }else{
-            nextSectorDirectory=-1;
-        }
-    int *data2=(int*)nextSector;
-    for (int i = 0; i < numSectors; i++)
-	{   if (i<NumDirect)
-            dataSectors[i] = freeMap->Find();
-        else{
-            data2[i-NumDirect]=freeMap->Find();
-        }
-    };
+    this->numBytes=fileSize;
+
     printf("allocate: ");
-     for (int i = 0; i < numSectors; i++){
-          if (i<NumDirect)
-            printf("%d\t", dataSectors[i] );
-        else{
-             printf("data2:%d\t", data2[i-NumDirect] );
-        }
-     }
+    for (int i = 0; i < numSectors; i++)
+        printf("%d\t", DataSector(i));
     printf("\n");
-    if (isNeedTwoIndex){
-        synchDisk->WriteSector(nextSectorDirectory,nextSector);
-        delete[] nextSector;
-    }
     return TRUE;
 }
 
 //----------------------------------------------------------------------
 // FileHeader::Deallocate
-// 	De-allocate all the space allocated for data blocks for this file.
+// 	De-allocate all the space allocated for data blocks for this file,
+//	and for the indirect blocks.
 //
 //	"freeMap" is the bit map of free disk sectors
 //----------------------------------------------------------------------
@@ -102,31 +376,23 @@ FileHeader::Allocate(BitMap *freeMap, int fileSize)
 void 
 FileHeader::Deallocate(BitMap *freeMap)
 {
-    int numSectors  = divRoundUp(numBytes, SectorSize);
-    char *twoIndex=new char[SectorSize];
-    int* n=(int*)twoIndex;
-    if (nextSectorDirectory!=-1)
-    {
-        synchDisk->ReadSector(nextSectorDirectory,twoIndex);
+    Extent *extent;
 
-    }
-    for (int i = 0; i < numSectors; i++) {
-	if(i<NumDirect){
-        ASSERT(freeMap->Test((int) dataSectors[i]));  // ought to be marked!
-	    freeMap->Clear((int) dataSectors[i]);
-    }
-    else{
-        freeMap->Clear((int) n[i-NumDirect]);
-    }} 
-    if (nextSectorDirectory!=-1){
-        delete[] twoIndex;
-        freeMap->Clear(nextSectorDirectory);
-    }
+    for (int k = 0; k < numExtents; k++) {
+        extent = ExtentSlot(k, NULL);
+        for (int i = 0; i < extent->length; i++) {
+            ASSERT(freeMap->Test(extent->start + i));  // ought to be marked!
+	    freeMap->Clear(extent->start + i);
+        }
+    } 
+    for (int l = 0; l < NumIndirectLevels; l++)
+        FreeTree(freeMap, indirectSector[l], l + 1);
 }
 
 //----------------------------------------------------------------------
 // FileHeader::FetchFrom
-// 	Fetch contents of file header from disk. 
+// 	Fetch contents of file header from disk.  The indirect blocks are
+//	read later, as they are needed.
 //
 //	"sector" is the disk sector containing the file header
 //----------------------------------------------------------------------
@@ -134,12 +400,20 @@ FileHeader::Deallocate(BitMap *freeMap)
 void
 FileHeader::FetchFrom(int sector)
 {
+    IndirectBlock *block;
+
     synchDisk->ReadSector(sector, (char *)this);
+    while ((block = blocks) != NULL) {	// any copies are out of date
+        blocks = block->next;
+        delete block;
+    }
+    hintExtent = hintFirst = 0;
 }
 
 //----------------------------------------------------------------------
 // FileHeader::WriteBack
-// 	Write the modified contents of the file header back to disk. 
+// 	Write the modified contents of the file header back to disk,
+//	along with any indirect blocks that have changed.
 //
 //	"sector" is the disk sector to contain the file header
 //----------------------------------------------------------------------
@@ -147,12 +421,12 @@ FileHeader::FetchFrom(int sector)
 void
 FileHeader::WriteBack(int sector)
 {   
-    // int *n=(int *)this;
-    // printf("this:");
-    // for (int i=0;i<SectorSize/4;i++)
-    // printf(" %d \n",n[i]);
-    //printHeader();
     synchDisk->WriteSector(sector, (char *)this); 
+    for (IndirectBlock *block = blocks; block != NULL; block = block->next)
+        if (block->dirty) {
+            synchDisk->WriteSector(block->sector, (char *)block->entries);
+            block->dirty = FALSE;
+        }
 }
 
 //----------------------------------------------------------------------
@@ -165,34 +439,28 @@ FileHeader::WriteBack(int sector)
 //	"offset" is the location within the file of the byte in question
 //----------------------------------------------------------------------
 
-/// @brief get Sector number by offset
-/// @param offset 
-/// @return Sector number
 int
 FileHeader::ByteToSector(int offset)
-{   int trueSectorNumber;
-    //
-   // ASSERT(offset<getNumBytes());
-  
-    if (offset/SectorSize< NumDirect)
-        //in 29 1-level index 
-        trueSectorNumber=(dataSectors[offset / SectorSize]);
-    else{
-        //in 2-level index   
-        char* twoLevelIndex=new char[SectorSize];
-
-        synchDisk->ReadSector(nextSectorDirectory,twoLevelIndex);
-        int *data=(int *)twoLevelIndex;
-        int indexIn2Level=(offset/SectorSize)-NumDirect;        
-        // for (int i=0;i++;i<sizeof(int))
-        // {
-        //     trueSectorNumber+=(twoLevelIndex[indexIn2Level+(sizeof(int)-i-1)]<<8*i);
-        // }
-        trueSectorNumber=data[indexIn2Level];
-        delete twoLevelIndex;
-    }
-   //  printf("\nbyteTosector:%d\n",trueSectorNumber);
-    return trueSectorNumber;
+{
+    return DataSector(offset / SectorSize);
+}
+
+//----------------------------------------------------------------------
+// FileHeader::ByteRangeToSectors
+// 	Find the disk sectors storing the "length" bytes starting at
+//	"offset" within the file, and put them, in order, in "sectors".
+//	Return how many there are.
+//----------------------------------------------------------------------
+
+int
+FileHeader::ByteRangeToSectors(int offset, int length, int *sectors)
+{
+    int first = offset / SectorSize;
+    int last = (offset + length - 1) / SectorSize;
+
+    for (int i = first; i <= last; i++)
+        sectors[i - first] = DataSector(i);
+    return last - first + 1;
 }
 
 //----------------------------------------------------------------------
@@ -229,30 +497,12 @@ FileHeader::Print()
         "File blocks:\n", numBytes, s);
     }
     //++++++++++++++cl add++++++++++++++
-    if (nextSectorDirectory!=-1){
-
-    }
     int numSectors = divRoundUp(numBytes, SectorSize);
-    char *twoIndex=new char[SectorSize];
-    int* n=(int*)twoIndex;
-    if (nextSectorDirectory!=-1)
-    {
-        synchDisk->ReadSector(nextSectorDirectory,twoIndex);
-
-    }
-    n=(int *)twoIndex;
     for (i = 0; i < numSectors; i++)
-	{   if(i<NumDirect)
-        printf("%d ", dataSectors[i]);
-        else
-        printf("%d ",n[i-NumDirect]);
-    }
+        printf("%d ", DataSector(i));
     printf("\nFile contents:\n");
     for (i = k = 0; i < numSectors; i++) {
-    if(i<NumDirect)
-	synchDisk->ReadSector(dataSectors[i], data);
-    else
-    synchDisk->ReadSector(n[i-NumDirect], data);
+	synchDisk->ReadSector(DataSector(i), data);
         for (j = 0; (j < SectorSize) && (k < numBytes); j++, k++) {
 	    if ('\040' <= data[j] && data[j] <= '\176')   // isprint(data[j])
 		printf("%c", data[j]);
@@ -264,72 +514,18 @@ FileHeader::Print()
     delete [] data;
 }
 //after extend() ,we need  writeBack() head 
-bool FileHeader::extend(int newLength) {
+// "freeMap" is the file system's own, in memory; the caller (see
+// FileSystem::Extend) holds its lock, and writes it back
+bool FileHeader::extend(BitMap *freeMap, int newLength) {
 
     // 计算之前和所需的扇区数量
     int new_sectors_num = divRoundUp(newLength, SectorSize);
     int pre_sectors_num = divRoundUp(numBytes, SectorSize);
 
     if(new_sectors_num > pre_sectors_num){
-        int extraSector = new_sectors_num - pre_sectors_num;
-        bool isNeed=0;
-        //test if need secondIndex    
-        if (new_sectors_num>NumDirect && pre_sectors_num<=NumDirect){
-            extraSector++;
-            isNeed=1;
-        }    
-        // 从磁盘中取出位图
-        OpenFile *bitmapfile = new OpenFile(FreeMapSector);
-        BitMap *freeMap = new BitMap(NumSectors);
-        freeMap->FetchFrom(bitmapfile);
-       // printf("\n%d is need %d,free:%d\n",isNeed,extraSector,freeMap->NumClear());
-        
-        // 判断空间是否够用，文件头只有一个header,
-        ASSERT(freeMap->NumClear()>extraSector);
-        // printf("\n%d is need %d,free:%d\n",isNeed,extraSector,freeMap->NumClear());
-        //need secondIndex
-        if (isNeed)
-        {
-            
-            nextSectorDirectory=freeMap->Find();
-            // printf("\n xia yi ge %d\n",nextSectorDirectory);
-            for(int i = pre_sectors_num; i<NumDirect; i++) {
-            dataSectors[i] = freeMap->Find();
-            }
-            int* data2Index=new int[new_sectors_num-NumDirect];
-            for(int i=0;i<new_sectors_num-NumDirect;i++){
-                data2Index[i]=freeMap->Find();
-            }
-
-            synchDisk->WriteSector(nextSectorDirectory,(char *)data2Index);
-            delete[]data2Index;
-        }//had secondIndex
-        else if  (pre_sectors_num>NumDirect){
-
-            int* data2Index=new int[SectorSize/4];
-            synchDisk->ReadSector(nextSectorDirectory,(char *)data2Index);
-            for(int i=pre_sectors_num-NumDirect;i<new_sectors_num-NumDirect;i++){
-                data2Index[i]=freeMap->Find();
-                //printf("%d hao :%d",data2Index[i],i);
-            }
-            // printf(",,%d",freeMap->Test(41));
-            // printf("pre %d,new %d \n ",pre_sectors_num-NumDirect,new_sectors_num-NumDirect);
-            // for(int i=0;i<SectorSize/4;i++){
-            //     printf("i:%d ,, %d",i,data2Index[i]);
-            // }
-            
-            synchDisk->WriteSector(nextSectorDirectory,(char *)data2Index);
-            delete[]data2Index;
-        //withoutSecondIndex
-        }else{
-            for(int i = pre_sectors_num; i<new_sectors_num; i++) {
-                dataSectors[i] = freeMap->Find();
-            }
-        }
-        // 存储bitmap
-        freeMap->WriteBack(bitmapfile);
-        delete freeMap;
-        delete bitmapfile;  
+        // 判断空间是否够用, and add the data and indirect blocks
+        if (!Grow(freeMap, new_sectors_num))
+            return false;
     }
 
     // 修改长度
@@ -355,19 +551,14 @@ FileHeader::getTime() {
 
 void 
 FileHeader::printHeader(){
-        printf("\nnumbytes %d\n sectors:",numBytes);
-      for (int i = 0; i < NumDirect; i++)
+      printf("\nnumbytes %d\n extents:",numBytes);
+      for (int k = 0; k < numExtents; k++)
       {
-        printf("%d,",dataSectors[i]);
+        Extent *extent = ExtentSlot(k, NULL);
+        printf("%d+%d,",extent->start,extent->length);
       }
       printf("\n");
-      if(nextSectorDirectory!=-1){
-        printf("next %d\n ",nextSectorDirectory);
-        char*data=new char[SectorSize];
-        synchDisk->ReadSector(nextSectorDirectory, data);
-        int *n=(int *)data;
-        for (int i=0;i<SectorSize/4;i++){
-          printf("%d, ",n[i]);
-        }
-      }
-}
\ No newline at end of file
+      for (int l = 0; l < NumIndirectLevels; l++)
+        if (indirectSector[l] != -1)
+          printf("indirect level %d: %d\n ", l + 1, indirectSector[l]);
+}
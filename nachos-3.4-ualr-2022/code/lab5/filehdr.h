@@ -18,27 +18,71 @@
 #include "bitmap.h"
 #include"synchdisk.h"
 #include"filesys.h"
-#define NumDirect 	(int)((SectorSize - 3 * sizeof(int)) / sizeof(int))
-#define MaxFileSize 	(NumDirect * SectorSize)
+#define NumIndirectLevels	3	// single, double and triple indirect
+#define NumDirect 	(int)((SectorSize - (3 + NumIndirectLevels) * sizeof(int)) \
+					/ sizeof(Extent))
+					// extents in the header itself
+#define NumIndirect	(int)(SectorSize / sizeof(int))
+					// sector numbers in an indirect block
+#define ExtentsPerBlock	(int)(SectorSize / sizeof(Extent))
+					// extents in a bottom-level one
+#define MaxExtents	(NumDirect + ExtentsPerBlock \
+			+ NumIndirect * ExtentsPerBlock \
+			+ NumIndirect * NumIndirect * ExtentsPerBlock)
+#define MaxFileSectors	NumSectors	// an extent can be any length, so
+					// only the disk limits a file
+#define MaxFileSize 	(MaxFileSectors * SectorSize)
 #define NumExtraWord    2
+
+// An extent: a run of "length" consecutive data blocks of a file,
+// starting at sector "start".
+struct Extent {
+    int start;
+    int length;
+};
+
+// An indirect block of a file, read into memory.  At the bottom level
+// it holds extents; above that, each entry is the sector number of
+// another indirect block, or 0 if there is none yet (sector 0 holds
+// the free map's header, so can't be part of any other file).
+struct IndirectBlock {
+    int sector;				// where it lives on disk
+    union {
+        int entries[NumIndirect];
+        Extent extents[ExtentsPerBlock];
+    };
+    bool dirty;				// modified since it was read?
+    IndirectBlock *next;		// the next block cached for the file
+};
+
 // The following class defines the Nachos "file header" (in UNIX terms,  
 // the "i-node"), describing where on disk to find all of the data in the file.
-// The file header is organized as a simple table of pointers to
-// data blocks. 
+// The file header is organized as a table of extents, each a run of
+// consecutive data blocks, followed, as in UNIX, by the roots of
+// three trees of indirect blocks: a single indirect block, listing
+// the next ExtentsPerBlock extents; a double indirect block, listing
+// blocks of extents for the next NumIndirect * ExtentsPerBlock; and a
+// triple indirect block, for NumIndirect times as many again.  Even
+// with every data block an extent of its own, that is more than the
+// whole disk; a file stored contiguously needs just one.
 //
 // The file header data structure can be stored in memory or on disk.
 // When it is on disk, it is stored in a single sector -- this means
 // that we assume the size of this data structure to be the same
-// as one disk sector.  Without indirect addressing, this
-// limits the maximum file length to just under 4K bytes.
+// as one disk sector.  Only the fields up to "indirectSector" are
+// stored on disk.
+//
+// The file header can be initialized by allocating blocks for the
+// file (if it is a new file), or by reading it from disk.
 //
-// There is no constructor; rather the file header can be initialized
-// by allocating blocks for the file (if it is a new file), or by
-// reading it from disk.
+// Indirect blocks are read into memory the first time they are
+// needed, and kept there with the rest of the header; changes to them
+// are written back along with the header.
 
 class FileHeader {
   public:
     FileHeader();
+    ~FileHeader();			// free the cached indirect blocks
 
     bool Allocate(BitMap *bitMap, int fileSize);// Initialize a file header, 
 						//  including allocating space 
@@ -53,13 +97,16 @@ class FileHeader {
     int ByteToSector(int offset);	// Convert a byte offset into the file
 					// to the disk sector containing
 					// the byte
+    int ByteRangeToSectors(int offset, int length, int *sectors);
+					// Find the sectors containing a
+					// range of bytes, all at once
 
     int FileLength();			// Return the length of the file 
 					// in bytes
 
     void Print();			// Print the contents of the file.
     void PrintSize();
-    bool extend(int newSize);
+    bool extend(BitMap *freeMap, int newSize);
     void printHeader();
     int getNumBytes();
     void setTime(int time);
@@ -67,10 +114,27 @@ class FileHeader {
   private:
     int numBytes;			// Number of bytes in the file
     int time;			// 时间戳记录
-    int dataSectors[NumDirect];		// Disk sector numbers for each data 
-					// block in the file
+    int numExtents;			// Number of extents in the file
+    Extent extents[NumDirect];		// The first extents of data blocks
+    int indirectSector[NumIndirectLevels];
+					// the single, double and triple
+					// indirect blocks, or -1 if none
+
+    // The rest of the header is only kept in memory.
+    IndirectBlock *blocks;		// the indirect blocks read in so far
+    int hintExtent, hintFirst;		// the extent DataSector last found a
+					// block in, and its first block #
 
-    int nextSectorDirectory;//Next directory 
+    IndirectBlock *Block(int sector);	// read in an indirect block
+    IndirectBlock *NewBlock(int sector);// start a new, empty one
+    Extent *ExtentSlot(int k, BitMap *freeMap);
+					// where the k'th extent is kept
+    int DataSector(int i);		// sector # of the i'th data block
+    bool Grow(BitMap *freeMap, int numSectors);
+					// add data blocks, up to "numSectors"
+    void FreeTree(BitMap *freeMap, int sector, int level);
+					// free an indirect block and
+					// everything under it
 };
 
 #endif // FILEHDR_H
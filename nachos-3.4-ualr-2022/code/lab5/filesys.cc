@@ -11,30 +11,39 @@
 //
 // 	The file system consists of several data structures:
 //	   A bitmap of free disk sectors (cf. bitmap.h)
-//	   A directory of file names and file headers
+//	   A root directory of file names and file headers
 //
 //      Both the bitmap and the directory are represented as normal
 //	files.  Their file headers are located in specific sectors
 //	(sector 0 and sector 1), so that the file system can find them 
 //	on bootup.
 //
+//	A file in a directory may itself be a directory, so that files
+//	are named by paths, such as "/jobs/7/out".  The names looked up
+//	along the way are remembered in a name cache (cf. namecache.h),
+//	so that most lookups don't need to read the directories.
+//
 //	The file system assumes that the bitmap and directory files are
-//	kept "open" continuously while Nachos is running.
+//	kept "open" continuously while Nachos is running.  Their contents
+//	are read into memory once, when the file system is mounted, and
+//	kept there too.
 //
 //	For those operations (such as Create, Remove) that modify the
-//	directory and/or bitmap, if the operation succeeds, the changes
-//	are written immediately back to disk (the two files are kept
-//	open during all this time).  If the operation fails, and we have
-//	modified part of the directory and/or bitmap, we simply discard
-//	the changed version, without writing it back to disk.
+//	directory and/or bitmap, the in-memory copies are changed; if the
+//	operation succeeds, the sectors it changed are written back to
+//	disk (the two files are kept open during all this time).  If the
+//	operation fails, and we have modified part of the directory
+//	and/or bitmap, we undo the change in memory.
 //
 // 	Our implementation at this point has the following restrictions:
 //
-//	   there is no synchronization for concurrent accesses
-//	   files have a fixed size, set when the file is created
-//	   files cannot be bigger than about 3KB in size
-//	   there is no hierarchical directory structure, and only a limited
-//	     number of files can be added to the system
+//	   only the directory and bitmap are synchronized (a lookup
+//	     holds "dirLock" shared, a change holds it exclusively;
+//	     "mapLock" is held to change the bitmap, which files also
+//	     do when they grow); concurrent accesses to the same file
+//	     are not
+//	   files grow as they are written past the end (up to the free
+//	     space on the disk), but never shrink
 //	   there is no attempt to make the system robust to failures
 //	    (if Nachos exits in the middle of an operation that modifies
 //	    the file system, it may corrupt the disk)
@@ -50,12 +59,14 @@
 #include "directory.h"
 #include "filehdr.h"
 #include "filesys.h"
+#include "namecache.h"
+#include "synch.h"
+#include "system.h"
 
 
 
-// Initial file sizes for the bitmap and directory; until the file system
-// supports extensible files, the directory size sets the maximum number 
-// of files that can be loaded onto the disk.
+// Initial file sizes for the bitmap and directory; the directory grows
+// as files are added (see GrowDirectory).
 #define FreeMapFileSize 	(NumSectors / BitsInByte)
 #define NumDirEntries 		10
 #define DirectoryFileSize 	(sizeof(DirectoryEntry) * NumDirEntries)
@@ -79,10 +90,13 @@ FileSystem::FileSystem(bool format)
 { 
     printf("my_file_System\n");
     DEBUG('f', "Initializing the file system.\n");
+    dirLock = new RWLock("directory lock", PreferWriters);
+    mapLock = new Lock("free map lock");
+    names = new NameCache;
     if (format) {
         
-        BitMap *freeMap = new BitMap(NumSectors);
-        Directory *directory = new Directory(NumDirEntries);
+        freeMap = new BitMap(NumSectors);
+        directory = new Directory(NumDirEntries);
         Account*  account=new Account(NumUser);
 	FileHeader *mapHdr = new FileHeader;
 	FileHeader *dirHdr = new FileHeader;
@@ -137,16 +151,19 @@ FileSystem::FileSystem(bool format)
 	    directory->Print();
         //account->print();
         }
-        delete freeMap; 
-	delete directory; 
 	delete mapHdr; 
 	delete dirHdr;
 
     } else {
     // if we are not formatting the disk, just open the files representing
-    // the bitmap and directory; these are left open while Nachos is running
+    // the bitmap and directory; these are left open while Nachos is running,
+    // and their contents are kept in memory
         freeMapFile = new OpenFile(FreeMapSector);
         directoryFile = new OpenFile(DirectorySector);
+        freeMap = new BitMap(NumSectors);
+        freeMap->FetchFrom(freeMapFile);
+        directory = new Directory(NumDirEntries);
+        directory->FetchFrom(directoryFile);
         accountFile=new OpenFile(AccountSector);
         curUser=new AccountEntity;
         Account *account=new Account(NumUser);
@@ -157,6 +174,44 @@ FileSystem::FileSystem(bool format)
     }
 }
 
+//----------------------------------------------------------------------
+// FileSystem::~FileSystem
+// 	De-allocate the in-memory bitmap, directory and name cache.  Must
+//	be called *before* "synchDisk" is deleted, which writes back the
+//	disk cache.
+//
+//	This is called from Cleanup, as Nachos halts, so it must not wait
+//	for a lock or the disk.  Nothing needs writing here: every change
+//	to the bitmap and directory was written back as it was made.  For
+//	the same reason, the bitmap and directory files are left open --
+//	closing one might write back its header.
+//----------------------------------------------------------------------
+
+FileSystem::~FileSystem()
+{
+    delete freeMap;
+    delete directory;
+    delete names;
+}
+
+//----------------------------------------------------------------------
+// FileSystem::Sync
+// 	Write back the changed sectors of the bitmap and directory, and
+//	then everything in the disk cache.
+//----------------------------------------------------------------------
+
+void
+FileSystem::Sync()
+{
+    dirLock->AcquireWrite();
+    mapLock->Acquire();
+    directory->WriteBack(directoryFile);
+    freeMap->WriteBack(freeMapFile);
+    mapLock->Release();
+    dirLock->ReleaseWrite();
+    synchDisk->Flush();
+}
+
 void 
 FileSystem::login(char *name,char* passwd){
         Account *account=new Account(NumUser);
@@ -170,153 +225,388 @@ FileSystem::login(char *name,char* passwd){
             printf("login err\n");
         }
 }
+//----------------------------------------------------------------------
+// FileSystem::Walk
+// 	Follow the path name "path" down from the root directory, as far
+//	as its last part.  Set "dirSector" to the sector of the header of
+//	the directory that last part should be in, and copy the last part
+//	into "name".  Return FALSE if some part before the last is not a
+//	directory that exists, or if "path" names no file at all.
+//
+//	Parts of "path" are separated by '/'; a leading '/', doubled
+//	'/'s, and a trailing '/' don't matter.  Like the names in
+//	directories, each part is cut short at FileNameMaxLen characters.
+//
+//	Called with "dirLock" held.
+//----------------------------------------------------------------------
+
+bool
+FileSystem::Walk(char *path, int *dirSector, char *name)
+{
+    char *end;
+    int length, sector;
+    bool isDir;
+
+    *dirSector = DirectorySector;
+    for (;;) {
+	while (*path == '/')
+	    path++;
+	for (end = path; *end != '\0' && *end != '/'; end++)
+	    ;
+	length = end - path;
+	if (length > FileNameMaxLen)
+	    length = FileNameMaxLen;
+	strncpy(name, path, length);
+	name[length] = '\0';
+	while (*end == '/')
+	    end++;
+	if (*end == '\0')
+	    return length > 0;		// that was the last part
+	sector = Lookup(*dirSector, name, &isDir);
+	if (sector == -1 || !isDir)
+	    return FALSE;
+	*dirSector = sector;
+	path = end;
+    }
+}
+
+//----------------------------------------------------------------------
+// FileSystem::Lookup
+// 	Return the sector of the header of file "name" in the directory
+//	whose header is at "dirSector", and set "isDir" to whether it is
+//	a directory; return -1 if there is no such file.  The name cache
+//	is tried first, and then the directory itself.
+//
+//	Called with "dirLock" held.
+//----------------------------------------------------------------------
+
+int
+FileSystem::Lookup(int dirSector, char *name, bool *isDir)
+{
+    Directory *dir;
+    OpenFile *dirFile;
+    int sector;
+
+    if (names->Lookup(dirSector, name, &sector, isDir))
+	return sector;
+    dir = LoadDirectory(dirSector, &dirFile);
+    sector = dir->Find(name);
+    *isDir = dir->IsDir(name);
+    PutDirectory(dir, dirFile);
+    names->Enter(dirSector, name, sector, *isDir);
+    return sector;
+}
+
+//----------------------------------------------------------------------
+// FileSystem::LoadDirectory, FileSystem::PutDirectory
+// 	Return the directory whose header is at "sector", and set "file"
+//	to the open file holding it: the root, kept in memory, or another
+//	read from disk.  PutDirectory is called when done with it.
+//----------------------------------------------------------------------
+
+Directory *
+FileSystem::LoadDirectory(int sector, OpenFile **file)
+{
+    Directory *dir;
+
+    if (sector == DirectorySector) {
+	*file = directoryFile;
+	return directory;
+    }
+    *file = new OpenFile(sector);
+    dir = new Directory(NumDirEntries);
+    dir->FetchFrom(*file);
+    return dir;
+}
+
+void
+FileSystem::PutDirectory(Directory *dir, OpenFile *file)
+{
+    if (dir == directory)
+	return;
+    delete dir;
+    delete file;
+}
+
 //----------------------------------------------------------------------
 // FileSystem::Create
 // 	Create a file in the Nachos file system (similar to UNIX create).
 //	Since we can't increase the size of files dynamically, we have
 //	to give Create the initial size of the file.
 //
+//	"name" -- path name of file to be created
+//	"initialSize" -- size of file to be created
+//----------------------------------------------------------------------
+
+bool
+FileSystem::Create(char *name, int initialSize)
+{
+    DEBUG('f', "Creating file %s, size %d\n", name, initialSize);
+    return MakeEntry(name, initialSize, FALSE);
+}
+
+//----------------------------------------------------------------------
+// FileSystem::Mkdir
+// 	Create an empty directory (similar to UNIX mkdir).
+//
+//	"name" -- path name of directory to be created
+//----------------------------------------------------------------------
+
+bool
+FileSystem::Mkdir(char *name)
+{
+    DEBUG('f', "Creating directory %s\n", name);
+    return MakeEntry(name, DirectoryFileSize, TRUE);
+}
+
+//----------------------------------------------------------------------
+// FileSystem::MakeEntry
+// 	Create a file, or if "isDir", a directory, for Create or Mkdir.
+//
 //	The steps to create a file are:
+//	  Find the directory it goes in, from its path name
 //	  Make sure the file doesn't already exist
+//	  Make sure there is room in the directory
 //        Allocate a sector for the file header
 // 	  Allocate space on disk for the data blocks for the file
 //	  Add the name to the directory
 //	  Store the new file header on disk 
 //	  Flush the changes to the bitmap and the directory back to disk
 //
+//	A new directory also gets an empty table written to it.
+//
 //	Return TRUE if everything goes ok, otherwise, return FALSE.
 //
 // 	Create fails if:
+//		the directory it goes in doesn't exist
 //   		file is already in directory
 //	 	no free space for file header
-//	 	no free entry for file in directory
+//	 	no free space for a bigger directory
 //	 	no free space for data blocks for the file 
-//
-// 	Note that this implementation assumes there is no concurrent access
-//	to the file system!
-//
-//	"name" -- name of file to be created
-//	"initialSize" -- size of file to be created
 //----------------------------------------------------------------------
 
 bool
-FileSystem::Create(char *name, int initialSize)
+FileSystem::MakeEntry(char *path, int initialSize, bool isDir)
 {
-    Directory *directory;
-    BitMap *freeMap;
+    char name[FileNameMaxLen + 1];
+    Directory *dir, *newDir;
+    OpenFile *dirFile, *newFile;
     FileHeader *hdr;
-    int sector;
+    int dirSector, sector;
     bool success;
 
-    DEBUG('f', "Creating file %s, size %d\n", name, initialSize);
-
-    directory = new Directory(NumDirEntries);
-    directory->FetchFrom(directoryFile);
-
-    if (directory->Find(name) != -1)
+    dirLock->AcquireWrite();
+    if (!Walk(path, &dirSector, name)) {
+	dirLock->ReleaseWrite();
+	return FALSE;			// no directory to put it in
+    }
+    dir = LoadDirectory(dirSector, &dirFile);
+    if (dir->Find(name) != -1)
       success = FALSE;			// file is already in directory
+    else if (!GrowDirectory(dir, dirFile))
+      success = FALSE;			// no space for a bigger directory
     else {	
-        freeMap = new BitMap(NumSectors);
-        freeMap->FetchFrom(freeMapFile);
+        mapLock->Acquire();
         sector = freeMap->Find();	// find a sector to hold the file header
     	if (sector == -1) 		
             success = FALSE;		// no free block for file header 
-        else if (!directory->Add(name, sector))
+        else if (!dir->Add(name, sector, isDir)) {
+            freeMap->Clear(sector);
             success = FALSE;	// no space in directory
-	else {
+	} else {
     	    hdr = new FileHeader;
-	    if (!hdr->Allocate(freeMap, initialSize))
+	    if (!hdr->Allocate(freeMap, initialSize)) {
+            	dir->Remove(name);
+            	freeMap->Clear(sector);
             	success = FALSE;	// no space on disk for data
-	    else {	
+	    } else {	
 	    	success = TRUE;
 		// everthing worked, flush all changes back to disk
     	    	hdr->WriteBack(sector); 		
-    	    	directory->WriteBack(directoryFile);
     	    	freeMap->WriteBack(freeMapFile);
 	    }
             delete hdr;
 	}
-        delete freeMap;
+        mapLock->Release();
+	if (success) {
+	    if (isDir) {
+		newFile = new OpenFile(sector);
+		newDir = new Directory(NumDirEntries);
+		newDir->WriteBack(newFile);
+		delete newDir;
+		delete newFile;
+	    }
+	    dir->WriteBack(dirFile);
+	    names->Enter(dirSector, name, sector, isDir);
+	}
     }
-    delete directory;
+    PutDirectory(dir, dirFile);
+    dirLock->ReleaseWrite();
     return success;
 }
 
+//----------------------------------------------------------------------
+// FileSystem::GrowDirectory
+// 	Make room in directory "dir", held in "dirFile", for one more
+//	file: if its table is getting full, double it, and write it back,
+//	which grows the directory file.  Return FALSE if there is no
+//	space on disk for the bigger file, leaving the table as it was.
+//
+//	Called with "dirLock" held exclusively, but not "mapLock", since
+//	growing the file takes it.
+//----------------------------------------------------------------------
+
+bool
+FileSystem::GrowDirectory(Directory *dir, OpenFile *dirFile)
+{
+    int oldSize = dir->TableSize();
+
+    if (!dir->Crowded())
+	return TRUE;
+    DEBUG('f', "Growing a directory to %d entries\n", 2 * oldSize);
+    dir->Resize(2 * oldSize);
+    if (dir->WriteBack(dirFile))
+	return TRUE;
+    dir->Resize(oldSize);
+    return FALSE;
+}
+
 //----------------------------------------------------------------------
 // FileSystem::Open
 // 	Open a file for reading and writing.  
 //	To open a file:
-//	  Find the location of the file's header, using the directory 
+//	  Find the location of the file's header, using the directories
+//	    on its path
 //	  Bring the header into memory
 //
-//	"name" -- the text name of the file to be opened
+//	"name" -- the path name of the file to be opened
 //----------------------------------------------------------------------
 
 OpenFile *
-FileSystem::Open(char *name)
+FileSystem::Open(char *path)
 { 
-    Directory *directory = new Directory(NumDirEntries);
+    char name[FileNameMaxLen + 1];
     OpenFile *openFile = NULL;
-    int sector;
+    int dirSector, sector;
+    bool isDir;
 
-    DEBUG('f', "Opening file %s\n", name);
-    directory->FetchFrom(directoryFile);
-    sector = directory->Find(name); 
-    if (sector >= 0) 		
-	openFile = new OpenFile(sector);	// name was found in directory 
-    delete directory;
+    DEBUG('f', "Opening file %s\n", path);
+    dirLock->AcquireRead();
+    if (Walk(path, &dirSector, name)) {
+	sector = Lookup(dirSector, name, &isDir); 
+	if (sector >= 0) 		
+	    openFile = new OpenFile(sector);	// name was found in directory 
+    }
+    dirLock->ReleaseRead();
     return openFile;				// return NULL if not found
 }
 
 //----------------------------------------------------------------------
-// FileSystem::Remove
-// 	Delete a file from the file system.  This requires:
-//	    Remove it from the directory
+// FileSystem::Remove, FileSystem::Rmdir
+// 	Delete a file from the file system, or an empty directory (like
+//	UNIX unlink and rmdir).  RemoveEntry does the work, which
+//	requires:
+//	    Remove it from its directory
 //	    Delete the space for its header
 //	    Delete the space for its data blocks
 //	    Write changes to directory, bitmap back to disk
 //
 //	Return TRUE if the file was deleted, FALSE if the file wasn't
-//	in the file system.
+//	in the file system, or was the wrong kind, or was a directory
+//	that is not empty, or is open (see OpenFile::IsOpen).
 //
-//	"name" -- the text name of the file to be removed
+//	"name" -- the path name of the file to be removed
 //----------------------------------------------------------------------
 
 bool
 FileSystem::Remove(char *name)
 { 
-    Directory *directory;
-    BitMap *freeMap;
+    return RemoveEntry(name, FALSE);
+}
+
+bool
+FileSystem::Rmdir(char *name)
+{ 
+    return RemoveEntry(name, TRUE);
+}
+
+bool
+FileSystem::RemoveEntry(char *path, bool isDir)
+{ 
+    char name[FileNameMaxLen + 1];
+    Directory *dir, *child;
+    OpenFile *dirFile, *childFile;
     FileHeader *fileHdr;
-    int sector;
+    int dirSector, sector;
+    bool empty;
     
-    directory = new Directory(NumDirEntries);
-    directory->FetchFrom(directoryFile);
-    sector = directory->Find(name);
-    if (sector == -1) {
-       delete directory;
+    dirLock->AcquireWrite();
+    if (!Walk(path, &dirSector, name)) {
+       dirLock->ReleaseWrite();
+       return FALSE;			 // directory not found 
+    }
+    dir = LoadDirectory(dirSector, &dirFile);
+    sector = dir->Find(name);
+    if (sector == -1 || dir->IsDir(name) != isDir) {
+       PutDirectory(dir, dirFile);
+       dirLock->ReleaseWrite();
        return FALSE;			 // file not found 
     }
-   // printf("ok1\n");
+    if (OpenFile::IsOpen(sector)) {
+       PutDirectory(dir, dirFile);
+       dirLock->ReleaseWrite();
+       return FALSE;			 // still in use
+    }
+    if (isDir) {
+	child = LoadDirectory(sector, &childFile);
+	empty = child->IsEmpty();
+	PutDirectory(child, childFile);
+	if (!empty) {
+	    PutDirectory(dir, dirFile);
+	    dirLock->ReleaseWrite();
+	    return FALSE;
+	}
+    }
     fileHdr = new FileHeader;
     fileHdr->FetchFrom(sector);
 
-    freeMap = new BitMap(NumSectors);
-    freeMap->FetchFrom(freeMapFile);
- //   printf("ok2\n");
+    mapLock->Acquire();
     fileHdr->Deallocate(freeMap);  		// remove data blocks
     freeMap->Clear(sector);			// remove header block
-    directory->Remove(name);
-   // printf("ok4\n");
+    dir->Remove(name);
     freeMap->WriteBack(freeMapFile);		// flush to disk
-    directory->WriteBack(directoryFile);  
-     // printf("ok5\n");      // flush to disk
+    mapLock->Release();
+    dir->WriteBack(dirFile);        		// flush to disk
     delete fileHdr;
-    delete directory;
-    delete freeMap;
+    if (isDir)
+	names->Purge(sector);
+    names->Enter(dirSector, name, -1, FALSE);
+    PutDirectory(dir, dirFile);
+    dirLock->ReleaseWrite();
     return TRUE;
 } 
 
+//----------------------------------------------------------------------
+// FileSystem::Extend
+// 	Grow the file whose header is "hdr" to "newLength" bytes, taking
+//	any sectors it needs from the free map, which is written back.
+//	The caller writes back the header.  Return FALSE if there is not
+//	enough space.
+//----------------------------------------------------------------------
+
+bool
+FileSystem::Extend(FileHeader *hdr, int newLength)
+{
+    bool success;
+
+    mapLock->Acquire();
+    success = hdr->extend(freeMap, newLength);
+    if (success)
+	freeMap->WriteBack(freeMapFile);
+    mapLock->Release();
+    return success;
+}
+
 //----------------------------------------------------------------------
 // FileSystem::List
 // 	List all the files in the file system directory.
@@ -325,11 +615,9 @@ FileSystem::Remove(char *name)
 void
 FileSystem::List()
 {
-    Directory *directory = new Directory(NumDirEntries);
-
-    directory->FetchFrom(directoryFile);
+    dirLock->AcquireRead();
     directory->List();
-    delete directory;
+    dirLock->ReleaseRead();
 }
 
 //----------------------------------------------------------------------
@@ -347,8 +635,6 @@ FileSystem::Print()
 {
     FileHeader *bitHdr = new FileHeader;
     FileHeader *dirHdr = new FileHeader;
-    BitMap *freeMap = new BitMap(NumSectors);
-    Directory *directory = new Directory(NumDirEntries);
   //  printf("ok1\n");
     printf("Bit map file header:\n");
     bitHdr->FetchFrom(FreeMapSector);
@@ -358,34 +644,27 @@ FileSystem::Print()
     dirHdr->FetchFrom(DirectorySector);
     dirHdr->Print();
  //printf("ok3\n");
-    freeMap->FetchFrom(freeMapFile);
+    dirLock->AcquireRead();
+    mapLock->Acquire();
     freeMap->Print();
+    mapLock->Release();
 //  printf("ok4\n");
-    directory->FetchFrom(directoryFile);
     directory->Print();
+    dirLock->ReleaseRead();
 
     delete bitHdr;
     delete dirHdr;
-    delete freeMap;
-    delete directory;
 }
 //   Li changed
 void FileSystem::PrintSize(){
     int totalBytes=(NumSectors*SectorSize);
     printf("total disk size: %d \n",totalBytes);
-    FileHeader *bitHdr = new FileHeader;
-    FileHeader *dirHdr = new FileHeader;
-    BitMap *freeMap = new BitMap(NumSectors);
-    Directory *directory = new Directory(NumDirEntries);
-    freeMap->FetchFrom(freeMapFile);
-    directory->FetchFrom(directoryFile);
-    int numUsedSector=0;
-    for (int i=0;i<NumSectors;i++){
-        if(freeMap->Test(i)){
-                numUsedSector++;
-        }
-    }
+    dirLock->AcquireRead();
+    mapLock->Acquire();
+    int numUsedSector=NumSectors-freeMap->NumClear();
+    mapLock->Release();
     printf("total occupied sector :%d,size: %d \n",numUsedSector,numUsedSector*SectorSize);
     printf("total free size:%d\n",totalBytes-numUsedSector*SectorSize);
     directory->PrintTotal();
+    dirLock->ReleaseRead();
 }
@@ -9,6 +9,14 @@
 #define FreeMapSector 		0
 #define DirectorySector 	1
 #define AccountSector     2
+
+class RWLock;
+class Lock;
+class BitMap;
+class Directory;
+class FileHeader;
+class NameCache;
+
 class FileSystem {
   public:
     FileSystem(bool format);		// Initialize the file system.
@@ -17,6 +25,7 @@ class FileSystem {
     					// If "format", there is nothing on
 					// the disk, so initialize the directory
     					// and the bitmap of free blocks.
+    ~FileSystem();			// Close the file system, at shutdown
 
     bool Create(char *name, int initialSize);  	
 					// Create a file (UNIX creat)
@@ -25,6 +34,16 @@ class FileSystem {
 
     bool Remove(char *name);  		// Delete a file (UNIX unlink)
 
+    bool Mkdir(char *name);		// Create a directory (UNIX mkdir)
+
+    bool Rmdir(char *name);		// Delete an empty directory
+					// (UNIX rmdir)
+
+    bool Extend(FileHeader *hdr, int newLength);
+					// Grow a file to "newLength" bytes,
+					// taking sectors from the free map
+    void Sync();			// Write back everything changed
+
     void List();			// List all the files in the file system
 
     void Print();			// List all the files and their contents
@@ -38,6 +57,25 @@ class FileSystem {
 					// file names, represented as a file
    OpenFile* accountFile;
    AccountEntity* curUser;
+   BitMap* freeMap;			// the two files above, kept in
+   Directory* directory;		// memory while the disk is mounted
+   RWLock* dirLock;			// held shared to look up names,
+					// exclusive to change the directory
+   Lock* mapLock;			// held to change the bitmap
+   NameCache* names;			// names looked up lately
+
+   bool Walk(char *path, int *dirSector, char *name);
+					// find the directory "path" is in
+   int Lookup(int dirSector, char *name, bool *isDir);
+					// look up a name in a directory
+   Directory* LoadDirectory(int sector, OpenFile **file);
+   void PutDirectory(Directory *dir, OpenFile *file);
+					// get and put back a directory
+   bool MakeEntry(char *path, int initialSize, bool isDir);
+   bool RemoveEntry(char *path, bool isDir);
+					// Create/Mkdir and Remove/Rmdir
+   bool GrowDirectory(Directory *dir, OpenFile *dirFile);
+					// make room for one more file
 };
 
 #endif
\ No newline at end of file
@@ -8,7 +8,7 @@
 //
 // 	Most of this file is not needed until later assignments.
 //
-// Usage: nachos -d <debugflags> -rs <random seed #>
+// Usage: nachos -d <debugflags> -rs <random seed #> -lp [profile file] -lc
 //		-s -x <nachos file> -c <consoleIn> <consoleOut>
 //		-f -cp <unix file> <nachos file>
 //		-p <nachos file> -r <nachos file> -l -D -t
@@ -18,6 +18,9 @@
 //
 //    -d causes certain debugging messages to be printed (cf. utility.h)
 //    -rs causes Yield to occur at random (but repeatable) spots
+//    -lp profiles locks, semaphores and condition variables, printing
+//	the counts (to the file, if given) when Nachos halts
+//    -lc reports deadlocks and locks taken in inconsistent orders
 //    -z prints the copyright message
 //
 //  USER_PROGRAM
@@ -30,6 +33,7 @@
 //    -cp copies a file from UNIX to Nachos
 //    -p prints a Nachos file to stdout
 //    -r removes a Nachos file from the file system
+//    -mkdir creates a Nachos directory, -rmdir removes an empty one
 //    -l lists the contents of the Nachos directory
 //    -D prints the contents of the entire file system 
 //    -t tests the performance of the Nachos file system
@@ -142,6 +146,16 @@ main(int argc, char **argv)
 	    ASSERT(argc > 1);
 	    fileSystem->Remove(*(argv + 1));
 	    argCount = 2;
+	} else if (!strcmp(*argv, "-mkdir")) {	// make Nachos directory
+	    ASSERT(argc > 1);
+	    if (!fileSystem->Mkdir(*(argv + 1)))
+		printf("Unable to create directory %s\n", *(argv + 1));
+	    argCount = 2;
+	} else if (!strcmp(*argv, "-rmdir")) {	// remove Nachos directory
+	    ASSERT(argc > 1);
+	    if (!fileSystem->Rmdir(*(argv + 1)))
+		printf("Unable to remove directory %s\n", *(argv + 1));
+	    argCount = 2;
 	} else if (!strcmp(*argv, "-l")) {	// list Nachos directory
             fileSystem->List();
 	} else if (!strcmp(*argv, "-D")) {	// print entire filesystem
@@ -168,6 +182,11 @@ main(int argc, char **argv)
         }
 #endif // NETWORK
     }
+
+#ifdef FILESYS
+    fileSystem->Sync();		// write back the disk cache while there is
+				// still a thread to wait for the disk
+#endif
    
     currentThread->Finish();	// NOTE: if the procedure "main" 
 				// returns, then the program "nachos"
@@ -0,0 +1,218 @@
+// namecache.cc
+//	Routines to keep the cache of names looked up in directories.
+//
+//	Entries are found by hashing <directory, name> onto one of
+//	NameCacheBuckets chains, and replaced least recently used first.
+//	Free entries -- never used, or purged -- are kept at the back of
+//	the LRU list, so that they are the first to be reused.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "namecache.h"
+#include "system.h"
+
+//----------------------------------------------------------------------
+// Bucket
+// 	Return the hash chain for "name" in the directory whose header is
+//	at sector "dir".
+//----------------------------------------------------------------------
+
+static int
+Bucket(int dir, char *name)
+{
+    unsigned int h = dir;
+
+    for (int i = 0; i < FileNameMaxLen && name[i] != '\0'; i++)
+	h = h * 31 + (unsigned char) name[i];
+    return h % NameCacheBuckets;
+}
+
+//----------------------------------------------------------------------
+// NameCache::NameCache
+// 	Initialize the name cache, with every entry free.
+//----------------------------------------------------------------------
+
+NameCache::NameCache()
+{
+    lock = new Lock("name cache lock");
+    for (int i = 0; i < NameCacheBuckets; i++)
+	buckets[i] = NULL;
+    mru = lru = NULL;
+    for (int i = 0; i < NameCacheSize; i++) {	// all free, in LRU order
+	entries[i].dir = -1;
+	entries[i].hashNext = NULL;
+	entries[i].prev = lru;
+	entries[i].next = NULL;
+	if (lru == NULL)
+	    mru = &entries[i];
+	else
+	    lru->next = &entries[i];
+	lru = &entries[i];
+    }
+    hits = misses = 0;
+}
+
+//----------------------------------------------------------------------
+// NameCache::~NameCache
+// 	De-allocate the name cache, after saying (when debugging the file
+//	system) how often it was of use.
+//----------------------------------------------------------------------
+
+NameCache::~NameCache()
+{
+    DEBUG('f', "Name cache: hits %d, misses %d\n", hits, misses);
+    delete lock;
+}
+
+//----------------------------------------------------------------------
+// NameCache::Lookup
+// 	If the result of looking up "name" in the directory whose header
+//	is at sector "dir" is cached, set "sector" to the sector of its
+//	header -- -1 if it isn't there -- and "isDir" to whether it is a
+//	directory, and return TRUE.  Otherwise, return FALSE.
+//----------------------------------------------------------------------
+
+bool
+NameCache::Lookup(int dir, char *name, int *sector, bool *isDir)
+{
+    NameEntry *entry;
+
+    lock->Acquire();
+    if ((entry = Find(dir, name)) == NULL) {
+	misses++;
+	lock->Release();
+	return FALSE;
+    }
+    hits++;
+    Touch(entry);
+    *sector = entry->sector;
+    *isDir = entry->isDir;
+    lock->Release();
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// NameCache::Enter
+// 	Remember that "name", in the directory whose header is at sector
+//	"dir", has its header at "sector" -- or, if "sector" is -1, that
+//	there is no such name.  An entry already there is replaced; if
+//	there is none, the least recently used entry is taken.
+//----------------------------------------------------------------------
+
+void
+NameCache::Enter(int dir, char *name, int sector, bool isDir)
+{
+    NameEntry *entry;
+    int bucket;
+
+    lock->Acquire();
+    if ((entry = Find(dir, name)) == NULL) {
+	entry = lru;
+	if (entry->dir >= 0)
+	    Unhash(entry);
+	entry->dir = dir;
+	strncpy(entry->name, name, FileNameMaxLen);
+	entry->name[FileNameMaxLen] = '\0';
+	bucket = Bucket(dir, name);
+	entry->hashNext = buckets[bucket];
+	buckets[bucket] = entry;
+    }
+    entry->sector = sector;
+    entry->isDir = isDir;
+    Touch(entry);
+    lock->Release();
+}
+
+//----------------------------------------------------------------------
+// NameCache::Purge
+// 	Forget every name cached for the directory whose header is at
+//	sector "dir", which is being removed.
+//----------------------------------------------------------------------
+
+void
+NameCache::Purge(int dir)
+{
+    lock->Acquire();
+    for (int i = 0; i < NameCacheSize; i++)
+	if (entries[i].dir == dir) {
+	    Unhash(&entries[i]);
+	    entries[i].dir = -1;
+	    MakeLast(&entries[i]);
+	}
+    lock->Release();
+}
+
+//----------------------------------------------------------------------
+// NameCache::Find
+// 	Return the entry for "name" in "dir", or NULL if it is not in the
+//	cache.
+//----------------------------------------------------------------------
+
+NameEntry *
+NameCache::Find(int dir, char *name)
+{
+    NameEntry *entry;
+
+    for (entry = buckets[Bucket(dir, name)]; entry != NULL;
+						entry = entry->hashNext)
+	if (entry->dir == dir && !strncmp(entry->name, name, FileNameMaxLen))
+	    return entry;
+    return NULL;
+}
+
+//----------------------------------------------------------------------
+// NameCache::Unhash
+// 	Take "entry", which is in use, off its hash chain.
+//----------------------------------------------------------------------
+
+void
+NameCache::Unhash(NameEntry *entry)
+{
+    NameEntry **prev;
+
+    for (prev = &buckets[Bucket(entry->dir, entry->name)]; *prev != entry;
+						prev = &(*prev)->hashNext)
+	;
+    *prev = entry->hashNext;
+}
+
+//----------------------------------------------------------------------
+// NameCache::Touch, NameCache::MakeLast
+// 	Move "entry" to the front of the LRU list, since it has just
+//	been used; or to the back, since it is free.
+//----------------------------------------------------------------------
+
+void
+NameCache::Touch(NameEntry *entry)
+{
+    if (entry == mru)
+	return;
+    entry->prev->next = entry->next;	// unlink it
+    if (entry->next != NULL)
+	entry->next->prev = entry->prev;
+    else
+	lru = entry->prev;
+    entry->prev = NULL;			// put it at the front
+    entry->next = mru;
+    mru->prev = entry;
+    mru = entry;
+}
+
+void
+NameCache::MakeLast(NameEntry *entry)
+{
+    if (entry == lru)
+	return;
+    entry->next->prev = entry->prev;	// unlink it
+    if (entry->prev != NULL)
+	entry->prev->next = entry->next;
+    else
+	mru = entry->next;
+    entry->next = NULL;			// put it at the back
+    entry->prev = lru;
+    lru->next = entry;
+    lru = entry;
+}
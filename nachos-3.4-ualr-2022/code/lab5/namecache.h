@@ -0,0 +1,75 @@
+// namecache.h
+//	Data structures for remembering the results of looking up names
+//	in directories.
+//
+//	Resolving a path name looks up each of its parts in turn, each in
+//	the directory named by the part before; for any directory but the
+//	root, that means reading the directory from disk.  The name cache
+//	remembers, for recently looked up <directory, name> pairs, the
+//	sector of the file header found, and whether it is a directory --
+//	or that the name isn't there at all, since looking for a file that
+//	doesn't exist (before creating it, say) is common too.
+//
+//	The file system keeps the cache up to date as it changes its
+//	directories: it enters names as they are added, and their absence
+//	as they are removed.  When a directory is removed, everything
+//	cached about names in it is purged, since the sector of its
+//	header may be reused for another directory.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+
+#ifndef NAMECACHE_H
+#define NAMECACHE_H
+
+#include "directory.h"
+#include "synch.h"
+
+#define NameCacheSize		64	// # of names kept in the cache
+#define NameCacheBuckets	64	// # of hash chains, to find them
+
+// A name in the cache.
+class NameEntry {
+  public:
+    int dir;				// sector of the header of the directory
+					// looked in, or -1 if the entry is free
+    char name[FileNameMaxLen + 1];	// the name looked up
+    int sector;				// its file header, or -1 if the name
+					// is not in the directory
+    bool isDir;				// is it a directory?
+    NameEntry *hashNext;		// next in the same hash chain
+    NameEntry *prev, *next;		// neighbours in LRU order
+};
+
+// The following class defines the name cache: a fixed number of
+// entries, found by hashing, and replaced in LRU order.
+class NameCache {
+  public:
+    NameCache();			// Initialize an empty cache
+    ~NameCache();			// De-allocate it
+
+    bool Lookup(int dir, char *name, int *sector, bool *isDir);
+					// If "name" in "dir" is cached, set
+					// what it is, and return TRUE
+    void Enter(int dir, char *name, int sector, bool isDir);
+					// Remember what "name" in "dir" is;
+					// "sector" is -1 if it isn't there
+    void Purge(int dir);		// Forget every name in "dir"
+
+  private:
+    NameEntry entries[NameCacheSize];
+    NameEntry *buckets[NameCacheBuckets];	// hash chains
+    NameEntry *mru, *lru;		// ends of the LRU list
+    Lock *lock;				// one thread at a time
+    int hits, misses;
+
+    NameEntry *Find(int dir, char *name);	// the entry, or NULL
+    void Unhash(NameEntry *entry);	// take it off its hash chain
+    void Touch(NameEntry *entry);	// move it to the front of the LRU
+    void MakeLast(NameEntry *entry);	// move it to the back of the LRU
+};
+
+#endif // NAMECACHE_H
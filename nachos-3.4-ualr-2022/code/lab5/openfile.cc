@@ -5,7 +5,11 @@
 //	the OpenFile data structure).
 //
 //	Also as in UNIX, for convenience, we keep the file header in
-//	memory while the file is open.
+//	memory while the file is open.  Like UNIX's in-core inodes,
+//	there is only one copy of it, however many times the file is
+//	open: every OpenFile for the file shares the same FileHeader,
+//	so a change one makes (say, extending the file) is seen by the
+//	rest, and the header is read from disk only on the first open.
 //
 // Copyright (c) 1992-1993 The Regents of the University of California.
 // All rights reserved.  See copyright.h for copyright notice and limitation 
@@ -15,12 +19,109 @@
 #include "filehdr.h"
 #include "openfile.h"
 #include "system.h"
+#include "synch.h"
 #include "time.h"
 
+// An entry in the table of in-core file headers: the header of an
+// open file, and how many OpenFiles are using it.
+struct InCoreHeader {
+    int sector;				// where the header lives on disk
+    FileHeader *hdr;
+    int refCount;
+    InCoreHeader *next;
+};
+
+static InCoreHeader *inCoreHeaders = NULL;	// the open files' headers
+static Lock *inCoreLock = NULL;		// protects the table; created by
+					// the first GetHeader
+
+//----------------------------------------------------------------------
+// GetHeader
+// 	Return the in-core copy of the file header at "sector", reading
+//	it from disk if the file is not already open.  Every call must be
+//	matched by a PutHeader.
+//
+//	The lock is held while the header is read, so that two threads
+//	opening the file at once don't both read it.
+//----------------------------------------------------------------------
+
+static FileHeader *
+GetHeader(int sector)
+{
+    InCoreHeader *entry;
+
+    if (inCoreLock == NULL)
+	inCoreLock = new Lock("in-core headers");
+    inCoreLock->Acquire();
+    for (entry = inCoreHeaders; entry != NULL; entry = entry->next)
+	if (entry->sector == sector)
+	    break;
+    if (entry == NULL) {
+	entry = new InCoreHeader;
+	entry->sector = sector;
+	entry->hdr = new FileHeader;
+	entry->hdr->FetchFrom(sector);
+	entry->refCount = 0;
+	entry->next = inCoreHeaders;
+	inCoreHeaders = entry;
+    }
+    entry->refCount++;
+    inCoreLock->Release();
+    return entry->hdr;
+}
+
+//----------------------------------------------------------------------
+// PutHeader
+// 	Give up a reference to the in-core header at "sector"; when the
+//	last OpenFile using it is closed, free it.  Any changes must
+//	already have been written back.
+//----------------------------------------------------------------------
+
+static void
+PutHeader(int sector)
+{
+    InCoreHeader **prev, *entry;
+
+    inCoreLock->Acquire();
+    for (prev = &inCoreHeaders; (entry = *prev) != NULL; prev = &entry->next)
+	if (entry->sector == sector)
+	    break;
+    ASSERT(entry != NULL);
+    if (--entry->refCount == 0) {
+	*prev = entry->next;
+	delete entry->hdr;
+	delete entry;
+    }
+    inCoreLock->Release();
+}
+
+//----------------------------------------------------------------------
+// OpenFile::IsOpen
+// 	Return TRUE if some OpenFile is using the header at "sector".  The
+//	file system won't remove such a file: its header sector could be
+//	reused for a new file, and the next open would then find the old
+//	file's header here instead of reading the new one.
+//----------------------------------------------------------------------
+
+bool
+OpenFile::IsOpen(int sector)
+{
+    InCoreHeader *entry;
+
+    if (inCoreLock == NULL)		// nothing has been opened yet
+	return FALSE;
+    inCoreLock->Acquire();
+    for (entry = inCoreHeaders; entry != NULL; entry = entry->next)
+	if (entry->sector == sector)
+	    break;
+    inCoreLock->Release();
+    return entry != NULL;
+}
+
 //----------------------------------------------------------------------
 // OpenFile::OpenFile
 // 	Open a Nachos file for reading and writing.  Bring the file header
-//	into memory while the file is open.
+//	into memory while the file is open, unless it is there already.
 //
 //	"sector" -- the location on disk of the file header for this file
 //----------------------------------------------------------------------
@@ -28,17 +129,20 @@
 OpenFile::OpenFile(int sector)
 {
     this->headSector = sector;
-    hdr = new FileHeader;
-    hdr->FetchFrom(sector);
+    hdr = GetHeader(sector);
     //hdr->Print();
    // hdr->printHeader();
     seekPosition = 0;
     this->preLength = this->hdr->getNumBytes();
+    lastRead = -1;			// reading from the start is sequential
+    aheadWindow = 0;
+    aheadUntil = -1;
 }
 
 //----------------------------------------------------------------------
 // OpenFile::~OpenFile
 // 	Close a Nachos file, de-allocating any in-memory data structures.
+//	The file header goes too, if no one else has the file open.
 //----------------------------------------------------------------------
 
 OpenFile::~OpenFile()
@@ -52,7 +156,7 @@ OpenFile::~OpenFile()
         }
         WriteBack();
     }
-    delete hdr;
+    PutHeader(headSector);
 }
 
 //----------------------------------------------------------------------
@@ -130,6 +234,7 @@ OpenFile::ReadAt(char *into, int numBytes, int position)
     int fileLength = hdr->FileLength();
     int i, firstSector, lastSector, numSectors;
     char *buf;
+    int *sectors;
 
     if ((numBytes <= 0) || (position >= fileLength))
     	return 0; 				// check request
@@ -144,12 +249,16 @@ OpenFile::ReadAt(char *into, int numBytes, int position)
 
     // read in all the full and partial sectors that we need
     buf = new char[numSectors * SectorSize];
+    sectors = new int[numSectors];
+    hdr->ByteRangeToSectors(position, numBytes, sectors);
     for (i = firstSector; i <= lastSector; i++)	
-        synchDisk->ReadSector(hdr->ByteToSector(i * SectorSize), 
+        synchDisk->ReadSector(sectors[i - firstSector], 
 					&buf[(i - firstSector) * SectorSize]);
+    ReadAhead(firstSector, lastSector);
 
     // copy the part we want
     bcopy(&buf[position - (firstSector * SectorSize)], into, numBytes);
+    delete [] sectors;
     delete [] buf;
     return numBytes;
 }
@@ -163,13 +272,14 @@ OpenFile::WriteAt(char *from, int numBytes, int position)
     int i, firstSector, lastSector, numSectors;
     bool firstAligned, lastAligned;
     char *buf;
+    int *sectors;
  
     //++++++++++++++cl add++++++++++++++
     if ((numBytes <= 0) || (position > fileLength))
 		return 0;	
     if ((position + numBytes) > fileLength) {
         // printf("\njinru\n");
-		if (!hdr->extend(position+numBytes)) {
+		if (!fileSystem->Extend(hdr, position+numBytes)) {
             return 0;
         }else{
             WriteBack();
@@ -192,22 +302,75 @@ OpenFile::WriteAt(char *from, int numBytes, int position)
 
 // read in first and last sector, if they are to be partially modified
     if (!firstAligned)
-        ReadAt(buf, SectorSize, firstSector * SectorSize);	
+        ReadFileSector(firstSector, buf);
     if (!lastAligned && ((firstSector != lastSector) || firstAligned))
-        ReadAt(&buf[(lastSector - firstSector) * SectorSize], 
-				SectorSize, lastSector * SectorSize);	
+        ReadFileSector(lastSector,
+				&buf[(lastSector - firstSector) * SectorSize]);
 
 // copy in the bytes we want to change 
     bcopy(from, &buf[position - (firstSector * SectorSize)], numBytes);
 
 // write modified sectors back
+    sectors = new int[numSectors];
+    hdr->ByteRangeToSectors(position, numBytes, sectors);
     for (i = firstSector; i <= lastSector; i++)	
-        synchDisk->WriteSector(hdr->ByteToSector(i * SectorSize), 
+        synchDisk->WriteSector(sectors[i - firstSector], 
 					&buf[(i - firstSector) * SectorSize]);
+    delete [] sectors;
     delete [] buf;
     return numBytes;
 }
 
+//----------------------------------------------------------------------
+// OpenFile::ReadFileSector
+// 	Read sector "i" of the file into "into", for WriteAt to change
+//	part of.  This goes straight to the disk cache, not through
+//	ReadAt: the file isn't being read, so it must not count towards
+//	the read-ahead window -- a writer appending in small pieces would
+//	otherwise read ahead sectors it is about to overwrite.
+//----------------------------------------------------------------------
+
+void
+OpenFile::ReadFileSector(int i, char *into)
+{
+    synchDisk->ReadSector(hdr->ByteToSector(i * SectorSize), into);
+}
+
+//----------------------------------------------------------------------
+// OpenFile::ReadAhead
+// 	Called by ReadAt after reading sectors "first" through "last" of
+//	the file.  If the read picks up where the last one left off --
+//	in the same sector, or the next -- the file is being read
+//	sequentially, so ask the disk to read ahead the next aheadWindow
+//	sectors into its cache, without waiting for them.  The window
+//	starts small, and doubles with each sequential read, up to as
+//	many as the disk will queue; a read anywhere else closes it.
+//	Sectors already asked for are not asked for again.
+//----------------------------------------------------------------------
+
+void
+OpenFile::ReadAhead(int first, int last)
+{
+    int end = divRoundUp(hdr->FileLength(), SectorSize) - 1;
+
+    if (first == lastRead || first == lastRead + 1) {
+	if (aheadWindow == 0)
+	    aheadWindow = 2;
+	else if (aheadWindow < ReadAheadMax)
+	    aheadWindow *= 2;
+    } else {
+	aheadWindow = 0;
+	aheadUntil = last;
+    }
+    lastRead = last;
+    if (aheadUntil < last)
+	aheadUntil = last;
+    if (end > last + aheadWindow)
+	end = last + aheadWindow;
+    for (; aheadUntil < end; aheadUntil++)
+	synchDisk->ReadAhead(hdr->ByteToSector((aheadUntil + 1) * SectorSize));
+}
+
 //----------------------------------------------------------------------
 // OpenFile::Length
 // 	Return the number of bytes in the file.
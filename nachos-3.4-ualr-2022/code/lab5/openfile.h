@@ -85,6 +85,9 @@ class OpenFile {
 					// file (this interface is simpler 
 					// than the UNIX idiom -- lseek to 
 					// end of file, tell, lseek back
+
+    static bool IsOpen(int sector);	// Is the file whose header is at
+					// "sector" open?
 	
 	//++++++++++++++cl add++++++++++++++
 	void WriteBack();
@@ -97,6 +100,15 @@ class OpenFile {
 	int preLength;		// 保存一开始文件的长度
 	//++++++++++++++cl add++++++++++++++
 
+    int lastRead;			// last sector of the file read, or -1
+    int aheadWindow;			// # of sectors to read ahead of it;
+					// 0 unless reads are sequential
+    int aheadUntil;			// last sector already read ahead
+    void ReadAhead(int first, int last);// having read sectors "first" to
+					// "last", read ahead if sequential
+    void ReadFileSector(int i, char *into);
+					// read sector "i" for WriteAt
+
 
 };
 
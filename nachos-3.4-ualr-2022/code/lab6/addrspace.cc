@@ -38,6 +38,26 @@ SwapHeader (NoffHeader *noffH)
 	noffH->uninitData.inFileAddr = WordToHost(noffH->uninitData.inFileAddr);
 }
 
+//----------------------------------------------------------------------
+// LoadSegment
+// 	Read a segment of the executable into "space", a page at a time,
+//	since its pages need not be contiguous in physical memory.
+//----------------------------------------------------------------------
+
+static void
+LoadSegment(AddrSpace *space, OpenFile *executable, Segment *seg)
+{
+    char *span;
+    int n, done;
+
+    for (done = 0; done < seg->size; done += n) {
+	n = space->UserSpan(seg->virtualAddr + done, seg->size - done,
+					FALSE, &span);
+	ASSERT(n > 0);
+	executable->ReadAt(span, n, seg->inFileAddr + done);
+    }
+}
+
 //----------------------------------------------------------------------
 // AddrSpace::AddrSpace
 // 创建一个地址空间来运行一个用户程序。从一个“可执行”文件中加载程序，并设置好一切，以便我们可以开始执行用户指令。
@@ -52,6 +72,8 @@ SwapHeader (NoffHeader *noffH)
 
 AddrSpace::AddrSpace(OpenFile *executable)
 {
+    for (int id = 0; id < MaxOpenFiles; id++)
+	openFiles[id] = NULL;
     //+++++++++++++++++++++分配对应spaceID
     //保证有进程号可以分配
     ASSERT(ThreadMap->NumClear() >= 1);
@@ -78,6 +100,7 @@ AddrSpace::AddrSpace(OpenFile *executable)
     size = numPages * PageSize;
 
     ASSERT(numPages <= NumPhysPages);		//检查我们没有试图运行太大的东西，至少在我们有虚拟内存之前
+    ASSERT(numPages <= (unsigned) physMap->NumClear());
 
     DEBUG('a', "Initializing address space, num pages %d, size %d\n", 
 					numPages, size);
@@ -98,7 +121,9 @@ AddrSpace::AddrSpace(OpenFile *executable)
     //++++++++++++++++
     
 // 将整个地址空间归零，将单位化数据段和堆栈段归零
-    bzero(machine->mainMemory, size);
+    for (i = 0; i < numPages; i++)
+	bzero(&machine->mainMemory[pageTable[i].physicalPage * PageSize],
+					PageSize);
 
 // 然后，将代码和数据段复制到内存中
     //代码大小
@@ -107,28 +132,14 @@ AddrSpace::AddrSpace(OpenFile *executable)
     if (noffH.code.size > 0) {
         DEBUG('a', "Initializing code segment, at 0x%x, size %d\n", 
 			noffH.code.virtualAddr, noffH.code.size);
-        //+++++++++++++++++++++++
-        int code_page = noffH.code.virtualAddr/PageSize;//含有的页数
-        //物理页中按照顺序分配，所以从第code_page开始分配
-        int code_phy_addr = pageTable[code_page].physicalPage *PageSize;//代码的物理地址
-        
-        executable->ReadAt(&(machine->mainMemory[code_phy_addr]),
-			noffH.code.size, noffH.code.inFileAddr);
-        //+++++++++++++++读取实际物理地址
+        LoadSegment(this, executable, &noffH.code);
     }
     //数据大小
 
     if (noffH.initData.size > 0) {
         DEBUG('a', "Initializing data segment, at 0x%x, size %d\n", 
 			noffH.initData.virtualAddr, noffH.initData.size);
-        //+++++++++++++++++++++++
-        int data_page = noffH.initData.virtualAddr/PageSize;//含有的页数
-		int data_offset = noffH.initData.virtualAddr%PageSize;//页内偏移
-		int data_phy_addr = pageTable[data_page].physicalPage *PageSize + data_offset;//数据的物理地址
-
-        executable->ReadAt(&(machine->mainMemory[data_phy_addr]),
-			noffH.initData.size, noffH.initData.inFileAddr);
-        //++++++++++++++++++++++
+        LoadSegment(this, executable, &noffH.initData);
     }
 
 }
@@ -140,8 +151,10 @@ AddrSpace::AddrSpace(OpenFile *executable)
 
 AddrSpace::~AddrSpace()
 {
-    //++++++++++++释放spaceID对应的进程号
-    ThreadMap->Clear(spaceID);
+    for (int id = 0; id < MaxOpenFiles; id++)
+	delete openFiles[id];		// close anything left open
+    // the spaceID is given back by Exit or Join, once the exit status
+    // has been collected
     //++++++++++++释放物理页，物理页对应编号为pageTable[i].physicalPage
     for(int i=0;i<numPages; i++){
         physMap->Clear(pageTable[i].physicalPage);
@@ -202,3 +215,124 @@ void AddrSpace::RestoreState()
     machine->pageTable = pageTable;
     machine->pageTableSize = numPages;
 }
+
+//----------------------------------------------------------------------
+// AddrSpace::UserSpan
+// 	Find where the user buffer at "virtAddr", "size" bytes long,
+//	starts in physical memory, so that a system call can copy to or
+//	from it directly, rather than a byte at a time through
+//	Machine::ReadMem and WriteMem.  Only the part up to the end of
+//	the first page is contiguous; return its length, and set "*span"
+//	to point to it in machine->mainMemory.  The caller copies that
+//	much, then asks again for the rest.
+//
+//	The page is marked used, and if "writing", dirty, just as the
+//	machine would mark it.
+//
+//	Return -1 if the address is outside the address space, or if
+//	"writing" and the page is read-only.
+//----------------------------------------------------------------------
+
+int
+AddrSpace::UserSpan(int virtAddr, int size, bool writing, char **span)
+{
+    unsigned int vpn = (unsigned) virtAddr / PageSize;
+    unsigned int offset = (unsigned) virtAddr % PageSize;
+    TranslationEntry *entry;
+
+    if (virtAddr < 0 || vpn >= numPages)
+	return -1;
+    entry = &pageTable[vpn];
+    if (!entry->valid)
+	return -1;
+    if (writing && entry->readOnly)
+	return -1;
+    entry->use = TRUE;
+    if (writing)
+	entry->dirty = TRUE;
+    *span = &machine->mainMemory[entry->physicalPage * PageSize + offset];
+    if (size > (int)(PageSize - offset))
+	size = PageSize - offset;	// the rest is on the next page
+    return size;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::CopyInString
+// 	Copy the null-terminated string at "virtAddr" in the user's
+//	address space into "buf", which holds "size" bytes, a page at a
+//	time.  Return the length of the string, or -1 if it does not fit
+//	in "buf" (terminator included), or runs off the end of the
+//	address space.  "buf" is always null-terminated.
+//----------------------------------------------------------------------
+
+int
+AddrSpace::CopyInString(int virtAddr, char *buf, int size)
+{
+    char *span, *end;
+    int n, done;
+
+    for (done = 0; done < size; done += n) {
+	n = UserSpan(virtAddr + done, size - done, FALSE, &span);
+	if (n < 0)
+	    break;
+	if ((end = (char *)memchr(span, '\0', n)) != NULL) {
+	    bcopy(span, buf + done, end - span + 1);
+	    return done + (end - span);
+	}
+	bcopy(span, buf + done, n);
+    }
+    if (size > 0)
+	buf[0] = '\0';
+    return -1;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::AddOpenFile
+// 	Enter an open file in the process's open-file table, and return
+//	the OpenFileId that the process will use for it; or -1 if the
+//	table is full.  Slots 0 and 1 are never used, since those ids
+//	stand for the console (ConsoleInput and ConsoleOutput).
+//----------------------------------------------------------------------
+
+int
+AddrSpace::AddOpenFile(OpenFile *file)
+{
+    for (int id = 2; id < MaxOpenFiles; id++)
+	if (openFiles[id] == NULL) {
+	    openFiles[id] = file;
+	    return id;
+	}
+    return -1;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::FindOpenFile
+// 	Return the open file with the given OpenFileId, or NULL if there
+//	is none.
+//----------------------------------------------------------------------
+
+OpenFile *
+AddrSpace::FindOpenFile(int id)
+{
+    if (id < 0 || id >= MaxOpenFiles)
+	return NULL;
+    return openFiles[id];
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::CloseOpenFile
+// 	Close the open file with the given OpenFileId, and free its slot.
+//	Return FALSE if there is no such file.
+//----------------------------------------------------------------------
+
+bool
+AddrSpace::CloseOpenFile(int id)
+{
+    OpenFile *file = FindOpenFile(id);
+
+    if (file == NULL)
+	return FALSE;
+    delete file;
+    openFiles[id] = NULL;
+    return TRUE;
+}
@@ -68,6 +68,15 @@ void ExceptionHandler(ExceptionType which)
         AdvancePC();
         return;
     }
+    else if((which == SyscallException) && (type == SC_Exit)){
+        interrupt->Exit();		// never returns
+        ASSERT(FALSE);
+    }
+    else if((which == SyscallException) && (type == SC_Join)){
+        interrupt->Join();
+        AdvancePC();
+        return;
+    }
     //++++++++++++++++++++++++++需要实现系统调用PrintInt(int t)的判断
     else if((which == SyscallException) && (type == SC_PrintInt)){
         interrupt->PrintInt();
@@ -75,6 +84,36 @@ void ExceptionHandler(ExceptionType which)
         AdvancePC();
         return;
     }
+    else if((which == SyscallException) && (type == SC_Sleep)){
+        interrupt->Sleep();
+        AdvancePC();
+        return;
+    }
+    else if((which == SyscallException) && (type == SC_Create)){
+        interrupt->Create();
+        AdvancePC();
+        return;
+    }
+    else if((which == SyscallException) && (type == SC_Open)){
+        interrupt->Open();
+        AdvancePC();
+        return;
+    }
+    else if((which == SyscallException) && (type == SC_Read)){
+        interrupt->Read();
+        AdvancePC();
+        return;
+    }
+    else if((which == SyscallException) && (type == SC_Write)){
+        interrupt->Write();
+        AdvancePC();
+        return;
+    }
+    else if((which == SyscallException) && (type == SC_Close)){
+        interrupt->Close();
+        AdvancePC();
+        return;
+    }
     //+++++++++++++++++++++++++++++++++++++++++++
 
     else {
@@ -22,14 +22,19 @@
 
 #include "copyright.h"
 #include "interrupt.h"
+#include "lockcheck.h"
 #include "system.h"
 #include "addrspace.h"//导入需要的addrspace.h文件，用于创建新线程分配空间
+#include "syscall.h"
+#include "synch.h"
+
+#define MaxUserString	256	// longest file name a system call takes
 
 // String definitions for debugging messages
 
 static const char *intLevelNames[] = { "off", "on"};
 static const char *intTypeNames[] = { "timer", "disk", "console write", 
-			"console read", "network send", "network recv"};
+			"console read", "network send", "network recv", "alarm"};
 
 //----------------------------------------------------------------------
 // PendingInterrupt::PendingInterrupt
@@ -229,6 +234,8 @@ Interrupt::Idle()
     // is not reached.  Instead, the halt must be invoked by the user program.
 
     DEBUG('i', "Machine idle.  No interrupts to do.\n");
+    if (lockChecking)
+	LockCheckIdle();		// any thread still asleep is stuck
     printf("No threads ready or runnable, and no pending interrupts.\n");
     printf("Assuming the program completed.\n");
     Halt();
@@ -369,20 +376,48 @@ Interrupt::DumpState()
     fflush(stdout);
 }
 
+//----------------------------------------------------------------------
+// ExecProcess
+// 	The first thing a thread started by Exec does: jump to the user
+//	program, whose address space Exec has already set up.
+//----------------------------------------------------------------------
+
+static void
+ExecProcess(_int arg)
+{
+    currentThread->space->InitRegisters();	// set the initial register values
+    currentThread->space->RestoreState();	// load page table register
+    machine->Run();			// jump to the user progam
+    ASSERT(FALSE);			// it leaves by calling Exit
+}
+
+// Names of the threads running Exec'd programs.  A thread keeps a
+// pointer to its name, so it can't be on Exec's stack; and it is still
+// in use as the thread finishes, after its process is gone.
+static char processName[MAX_USERPROCESS][MaxUserString];
+
 //+++++++++++实现Exec()
+//----------------------------------------------------------------------
+// Interrupt::Exec
+// 	The Exec(name) system call: load the program "name" into a new
+//	address space, and fork a thread to run it, as a child of the
+//	calling process.  The caller carries on; its result, in r2, is
+//	the child's SpaceId, to pass to Join, or -1 if the program could
+//	not be started.
+//----------------------------------------------------------------------
 int Interrupt::Exec(){
     //输出信息，有一个Exec()的系统调用
         printf("Execute system call of Exec()\n");
 
         //从寄存器r4中读取文件名,r4中存放的实际为文件地址
-        char filename[50];
+        char filename[MaxUserString];
         int address = machine->ReadRegister(4);
+        machine->WriteRegister(2, -1);	// unless we get to the end
         //需要将文件地址转换为文件名称
-        for(int i=0; ;i++){
-            machine->ReadMem(address+i,1,(int *)&filename[i]);
-            if(filename[i] == '\0'){//读到文件名称结尾
-                break;
-            }
+        if (currentThread->space->CopyInString(address, filename,
+					MaxUserString) < 0) {
+            printf("bad file name for Exec!\n");
+            return -1;
         }
 
         //输出文件名称
@@ -395,32 +430,125 @@ int Interrupt::Exec(){
             printf("can't open the %s!\n",filename);
             return -1;
         }
+        if (ThreadMap->NumClear() == 0) {
+            printf("too many processes to Exec %s!\n", filename);
+            delete executable;
+            return -1;
+        }
 
         //使用addrspace分配地址空间
         AddrSpace *addrspace = new AddrSpace(executable);
-
-        //为当前文件创建线程
-        Thread* thread = new Thread(filename);
-        //原本使用fork实现，但由于获取当前线程startProcess(参考userprog/progtest.c文件)一直编译显示非法使用，所以改为直接调度
-        //先将当前进程保存至原有队列，参考synch.cc中v（）的实现
-        IntStatus oldLevel = interrupt->SetLevel(IntOff);
-        scheduler->ReadyToRun(currentThread);
-        (void) interrupt->SetLevel(oldLevel);
-        //再调度当前进程,参考progtest.cc中startprogress的实现
-        currentThread = thread;
+        delete executable;		// it has all been loaded
+        int spaceID = addrspace->getSpaceID();
+
+        Process *process = new Process;
+        process->parent = currentThread->space->getSpaceID();
+        process->exited = FALSE;
+        process->exitStatus = 0;
+        process->done = new Semaphore("process exit", 0);
+        processTable[spaceID] = process;
+
+        //为当前文件创建线程，由它在自己的内核栈上运行用户程序
+        strcpy(processName[spaceID], filename);
+        Thread* thread = new Thread(processName[spaceID]);
         thread->space = addrspace;
-        addrspace->InitRegisters();		// 设置寄存器值
-        addrspace->RestoreState();		// 获取页表
+        thread->Fork(ExecProcess, 0);
 
-
-        //系统调用完成后关闭文件
-        delete executable;
         //由于Exec()系统调用有返回值spaceID，因此，使用r2寄存器将SpaceId返回
-        machine->WriteRegister(2,addrspace->getSpaceID());
+        machine->WriteRegister(2, spaceID);
+        return spaceID;
+}
 
-        machine->Run();//事实上machine->Run()后不会再执行下面语句，所以return可有可无
-        ASSERT(FALSE);
-        return addrspace->getSpaceID();
+//----------------------------------------------------------------------
+// FreeProcess
+// 	Forget the process "id", and let its SpaceId be used again.
+//	Called with interrupts disabled.
+//----------------------------------------------------------------------
+
+static void
+FreeProcess(int id)
+{
+    Process *process = processTable[id];
+
+    if (process != NULL) {
+	delete process->done;
+	delete process;
+	processTable[id] = NULL;
+    }
+    ThreadMap->Clear(id);
+}
+
+//----------------------------------------------------------------------
+// Interrupt::Exit
+// 	The Exit(status) system call: the calling process is done, with
+//	the exit status in r4.  Give back its memory (and, with virtual
+//	memory, its swap space) and close its files, by deleting its
+//	address space; then either leave the status for the parent to
+//	Join, or, if there is no parent to do so, forget the process
+//	altogether.  Its own children are orphaned in turn.  Finally the
+//	thread finishes, so this never returns.
+//----------------------------------------------------------------------
+
+void Interrupt::Exit(){
+    int exitStatus = machine->ReadRegister(4);
+    AddrSpace *space = currentThread->space;
+    int id = space->getSpaceID();
+    Process *process;
+
+    DEBUG('a', "Process %d exits, with status %d\n", id, exitStatus);
+    IntStatus oldLevel = SetLevel(IntOff);
+
+    for (int child = 0; child < MAX_USERPROCESS; child++) {
+	process = processTable[child];
+	if (process == NULL || process->parent != id)
+	    continue;
+	if (process->exited)
+	    FreeProcess(child);		// never to be joined
+	else
+	    process->parent = -1;
+    }
+
+    currentThread->space = NULL;
+    delete space;
+
+    process = processTable[id];
+    if (process == NULL || process->parent < 0)
+	FreeProcess(id);		// no one is waiting for the status
+    else {
+	process->exited = TRUE;
+	process->exitStatus = exitStatus;
+	process->done->V();
+    }
+
+    currentThread->Finish();
+    (void) SetLevel(oldLevel);		// not reached
+}
+
+//----------------------------------------------------------------------
+// Interrupt::Join
+// 	The Join(id) system call: wait for the child process "id" (in r4)
+//	to exit, and return its exit status in r2, once.  Return -1 if
+//	"id" is not a child of the calling process that is yet to be
+//	joined.
+//----------------------------------------------------------------------
+
+int Interrupt::Join(){
+    int id = machine->ReadRegister(4);
+    Process *process;
+    int exitStatus = -1;
+
+    IntStatus oldLevel = SetLevel(IntOff);
+    if (id >= 0 && id < MAX_USERPROCESS
+		&& (process = processTable[id]) != NULL
+		&& process->parent == currentThread->space->getSpaceID()) {
+	process->done->P();		// returns at once if it has exited
+	exitStatus = process->exitStatus;
+	FreeProcess(id);
+    }
+    (void) SetLevel(oldLevel);
+
+    machine->WriteRegister(2, exitStatus);
+    return exitStatus;
 }
 
 
@@ -430,4 +558,129 @@ void Interrupt::PrintInt(){
     int t = machine->ReadRegister(4);
     //输出寄存器的值
     printf("%d\n",t);
-}
\ No newline at end of file
+}
+
+//----------------------------------------------------------------------
+// Interrupt::Sleep
+// 	The Sleep system call: put the calling thread to sleep for the
+//	number of ticks in r4, on the alarm clock's timing wheel.
+//----------------------------------------------------------------------
+void Interrupt::Sleep(){
+    alarmClock->WaitUntil(machine->ReadRegister(4));
+}
+
+//----------------------------------------------------------------------
+// Interrupt::Create, Interrupt::Open
+// 	The Create(name) and Open(name) system calls.  The name is in r4.
+//	Create makes an empty file, and returns 1 in r2 if it could, 0 if
+//	not; Open returns in r2 a new OpenFileId, or -1 on failure.
+//----------------------------------------------------------------------
+void Interrupt::Create(){
+    char name[MaxUserString];
+    int result = 0;
+
+    if (currentThread->space->CopyInString(machine->ReadRegister(4),
+					name, MaxUserString) >= 0)
+	result = fileSystem->Create(name, 0);
+    machine->WriteRegister(2, result);
+}
+
+void Interrupt::Open(){
+    char name[MaxUserString];
+    OpenFile *file = NULL;
+    int id = -1;
+
+    if (currentThread->space->CopyInString(machine->ReadRegister(4),
+					name, MaxUserString) >= 0)
+	file = fileSystem->Open(name);
+    if (file != NULL && (id = currentThread->space->AddOpenFile(file)) < 0)
+	delete file;			// too many files open
+    machine->WriteRegister(2, id);
+}
+
+//----------------------------------------------------------------------
+// Interrupt::Read, Interrupt::Write
+// 	The Read(buffer, size, id) and Write(buffer, size, id) system
+//	calls, with the arguments in r4, r5 and r6.  Data moves straight
+//	between the file and the frames holding the user's buffer, a page
+//	at a time, with no copy in between.  Each page is translated, and
+//	checked, before any data moves to or from it.  Read returns in r2
+//	the number of bytes read, Write the number written: if the buffer
+//	runs off the address space partway, what was moved before that.
+//	-1 if "id" is not open, or the buffer does not start in the
+//	address space.
+//
+//	ConsoleInput and ConsoleOutput are Nachos's own standard input and
+//	output.  A Read from the console returns what is there, waiting
+//	only if nothing is.
+//----------------------------------------------------------------------
+void Interrupt::Read(){
+    int virtAddr = machine->ReadRegister(4);
+    int size = machine->ReadRegister(5);
+    int id = machine->ReadRegister(6);
+    OpenFile *file = currentThread->space->FindOpenFile(id);
+    char *span;
+    int n, done, total = 0;
+
+    if (id != ConsoleInput && file == NULL)
+	total = -1;
+    while (total >= 0 && size > 0) {
+	n = currentThread->space->UserSpan(virtAddr, size, TRUE, &span);
+	if (n < 0) {
+	    if (total == 0)
+		total = -1;		// not a byte of it is there
+	    break;
+	}
+	if (id == ConsoleInput) {
+	    done = ReadPartial(0, span, n);
+	    stats->numConsoleCharsRead += done;
+	} else
+	    done = file->Read(span, n);
+	total += done;
+	if (done < n || id == ConsoleInput)
+	    break;			// end of file, or all there is
+	virtAddr += n;
+	size -= n;
+    }
+    machine->WriteRegister(2, total);
+}
+
+void Interrupt::Write(){
+    int virtAddr = machine->ReadRegister(4);
+    int size = machine->ReadRegister(5);
+    int id = machine->ReadRegister(6);
+    OpenFile *file = currentThread->space->FindOpenFile(id);
+    char *span;
+    int n, done, total = 0;
+
+    if (id != ConsoleOutput && file == NULL)
+	total = -1;
+    while (total >= 0 && size > 0) {
+	n = currentThread->space->UserSpan(virtAddr, size, FALSE, &span);
+	if (n < 0) {
+	    if (total == 0)
+		total = -1;		// not a byte of it is there
+	    break;
+	}
+	if (id == ConsoleOutput) {
+	    WriteFile(1, span, n);
+	    stats->numConsoleCharsWritten += n;
+	    done = n;
+	} else
+	    done = file->Write(span, n);
+	total += done;
+	if (done < n)
+	    break;			// no room for the rest
+	virtAddr += n;
+	size -= n;
+    }
+    machine->WriteRegister(2, total);
+}
+
+//----------------------------------------------------------------------
+// Interrupt::Close
+// 	The Close(id) system call, with "id" in r4.
+//----------------------------------------------------------------------
+void Interrupt::Close(){
+    (void) currentThread->space->CloseOpenFile(machine->ReadRegister(4));
+}
@@ -45,9 +45,12 @@ enum MachineStatus {IdleMode, SystemMode, UserMode};
 
 // IntType records which hardware device generated an interrupt.
 // In Nachos, we support a hardware timer device, a disk, a console
-// display and keyboard, and a network.
+// display and keyboard, and a network.  An AlarmInt is a one-shot
+// wakeup for a thread waiting with a time limit; unlike the periodic
+// timer, a pending alarm means there is still work to do when the
+// machine is idle.
 enum IntType { TimerInt, DiskInt, ConsoleWriteInt, ConsoleReadInt, 
-				NetworkSendInt, NetworkRecvInt};
+				NetworkSendInt, NetworkRecvInt, AlarmInt};
 
 // The following class defines an interrupt that is scheduled
 // to occur in the future.  The internal data structures are
@@ -111,8 +114,16 @@ class Interrupt {
 
     //++++++++++++++++定义ecec()的实现++++++++++++++
     int Exec();
+    void Exit();			// Exit(status) system call
+    int Join();				// Join(id) system call
     //+++++++++++++++定义PrintInt()的实现
     void PrintInt();
+    void Sleep();			// Sleep(ticks) system call
+    void Create();			// file system calls
+    void Open();
+    void Read();
+    void Write();
+    void Close();
     //++++++++++++++++++++++++++++++++++++
   private:
     IntStatus level;		// are interrupts enabled or disabled?
@@ -34,6 +34,7 @@
 //++++++++++++++++++++++++++++++++
 //需要定义PrintInt(int t)带有参数的系统调用
 #define SC_PrintInt 11
+#define SC_Sleep	12
 
 #ifndef IN_ASM
 
@@ -135,6 +136,11 @@ void Yield();
 //++++++++++++++++++++定义PrintInt(int t)
 void PrintInt(int t); 
 
+/* Put the calling thread to sleep for (at least) "ticks" ticks of
+ * simulated time, letting other threads run in the meantime.
+ */
+void Sleep(int ticks);
+
 #endif /* IN_ASM */
 
 #endif /* SYSCALL_H */
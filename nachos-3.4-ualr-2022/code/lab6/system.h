@@ -18,6 +18,7 @@
 #include "interrupt.h"
 #include "stats.h"
 #include "timer.h"
+#include "alarm.h"
 //+++++++++++++导入bitmap包，使用ThreadMap管理pid线程编号
 #include "bitmap.h"
 //+++++++++++++++++++++
@@ -34,10 +35,28 @@ extern Scheduler *scheduler;			// the ready list
 extern Interrupt *interrupt;			// interrupt status
 extern Statistics *stats;			// performance metrics
 extern Timer *timer;				// the hardware alarm clock
+extern Alarm *alarmClock;			// wakes up sleeping threads
 //++++++++++定义全局变量ThreadMap管理线程总数
 extern BitMap *ThreadMap;
 //++++++++++++++++++++++++++++++
 
+// A user process started by Exec.  Its entry in processTable, indexed
+// by its SpaceId, lasts from Exec until its parent has joined it, so
+// that the exit status outlives the process, and the SpaceId is not
+// given to anyone else in the meantime.  A process no one can join
+// (its parent has exited) is forgotten as soon as it exits.
+
+class Semaphore;
+
+struct Process {
+    int parent;				// SpaceId of the parent, or -1
+    bool exited;
+    int exitStatus;			// valid once "exited"
+    Semaphore *done;			// signalled by Exit, for Join
+};
+
+extern Process *processTable[MAX_USERPROCESS];
+
 #ifdef USER_PROGRAM
 #include "machine.h"
 extern Machine* machine;	// user program memory and registers
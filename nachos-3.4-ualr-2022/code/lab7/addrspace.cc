@@ -53,6 +53,8 @@ SwapHeader (NoffHeader *noffH)
 
 AddrSpace::AddrSpace(OpenFile *executable)
 {
+    for (int id = 0; id < MaxOpenFiles; id++)
+	openFiles[id] = NULL;
     //++++++++++++cl add++++++++++++
     this->executable = executable;
     usedFrame = 0;
@@ -88,9 +90,10 @@ AddrSpace::AddrSpace(OpenFile *executable)
     size = numPages * PageSize;
     swapSize = swapSize * PageSize;
 
-    // 创建交换区，uninitdata和stack
-    fileSystem->Create("SWAP", swapSize);
-    this->swapFile = fileSystem->Open("SWAP");
+    // 创建交换区，uninitdata和stack, one per process
+    sprintf(swapName, "SWAP%d", spaceID);
+    fileSystem->Create(swapName, swapSize);
+    this->swapFile = fileSystem->Open(swapName);
     char temp[swapSize];
     memset(temp, 0, sizeof(temp));
     this->swapFile->WriteAt(temp, swapSize, 0);
@@ -105,8 +108,8 @@ AddrSpace::AddrSpace(OpenFile *executable)
     // 输出页表
     Print();
 
-    // 将整个地址空间归零，将单位化数据段和堆栈段归零
-    bzero(machine->mainMemory, NumPhysPages * PageSize);
+    // Frames are zeroed as they are paged in (ReadIn), not here, since
+    // other processes may be using the rest of memory.
 
     //+++++++++++++cl add+++++++++++++
 }
@@ -120,14 +123,21 @@ AddrSpace::AddrSpace(OpenFile *executable)
 
 AddrSpace::~AddrSpace()
 {
-    //++++++++++++释放spaceID对应的进程号
-    ThreadMap->Clear(spaceID);
+    for (int id = 0; id < MaxOpenFiles; id++)
+	delete openFiles[id];		// close anything left open
+    // the spaceID is given back by Exit or Join, once the exit status
+    // has been collected
     //++++++++++++释放物理页，物理页对应编号为pageTable[i].physicalPage
     for(int i=0;i<numPages; i++){
-        physMap->Clear(pageTable[i].physicalPage);
+        if (pageTable[i].valid)		// only resident pages have frames
+            physMap->Clear(pageTable[i].physicalPage);
     }
     //+++++++++++++++++++
    delete [] pageTable;
+   delete [] pageType;
+   delete executable;
+   delete swapFile;
+   fileSystem->Remove(swapName);	// give back the swap space
    
 }
 
@@ -324,6 +334,9 @@ AddrSpace::WriteBack(int page) {
 
 void
 AddrSpace::ReadIn(int page) {
+    // the page may end before the frame does
+    bzero(&(machine->mainMemory[pageTable[page].physicalPage * PageSize]),
+                PageSize);
     switch (pageType[page]) {
         case CODE:
 	        executable->ReadAt(&(machine->mainMemory[pageTable[page].physicalPage * PageSize]), 
@@ -511,4 +524,126 @@ AddrSpace::processInQueue(int demandPage) {
     pageChance[demandPage] = 1;
     pageTime[demandPage] = 0;
 
-}
\ No newline at end of file
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::UserSpan
+// 	Find where the user buffer at "virtAddr", "size" bytes long,
+//	starts in physical memory, so that a system call can copy to or
+//	from it directly, rather than a byte at a time through
+//	Machine::ReadMem and WriteMem.  Only the part up to the end of
+//	the first page is contiguous; return its length, and set "*span"
+//	to point to it in machine->mainMemory.  The caller copies that
+//	much, then asks again for the rest.
+//
+//	The page is marked used, and if "writing", dirty, just as the
+//	machine would mark it.  If the page is not in memory, it is
+//	paged in first, as if the user program had touched it.
+//
+//	Return -1 if the address is outside the address space, or if
+//	"writing" and the page is read-only.
+//----------------------------------------------------------------------
+
+int
+AddrSpace::UserSpan(int virtAddr, int size, bool writing, char **span)
+{
+    unsigned int vpn = (unsigned) virtAddr / PageSize;
+    unsigned int offset = (unsigned) virtAddr % PageSize;
+    TranslationEntry *entry;
+
+    if (virtAddr < 0 || vpn >= numPages)
+	return -1;
+    entry = &pageTable[vpn];
+    if (!entry->valid)
+	demandPaging(vpn);		// fault the page in
+    if (writing && entry->readOnly)
+	return -1;
+    entry->use = TRUE;
+    if (writing)
+	entry->dirty = TRUE;
+    *span = &machine->mainMemory[entry->physicalPage * PageSize + offset];
+    if (size > (int)(PageSize - offset))
+	size = PageSize - offset;	// the rest is on the next page
+    return size;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::CopyInString
+// 	Copy the null-terminated string at "virtAddr" in the user's
+//	address space into "buf", which holds "size" bytes, a page at a
+//	time.  Return the length of the string, or -1 if it does not fit
+//	in "buf" (terminator included), or runs off the end of the
+//	address space.  "buf" is always null-terminated.
+//----------------------------------------------------------------------
+
+int
+AddrSpace::CopyInString(int virtAddr, char *buf, int size)
+{
+    char *span, *end;
+    int n, done;
+
+    for (done = 0; done < size; done += n) {
+	n = UserSpan(virtAddr + done, size - done, FALSE, &span);
+	if (n < 0)
+	    break;
+	if ((end = (char *)memchr(span, '\0', n)) != NULL) {
+	    bcopy(span, buf + done, end - span + 1);
+	    return done + (end - span);
+	}
+	bcopy(span, buf + done, n);
+    }
+    if (size > 0)
+	buf[0] = '\0';
+    return -1;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::AddOpenFile
+// 	Enter an open file in the process's open-file table, and return
+//	the OpenFileId that the process will use for it; or -1 if the
+//	table is full.  Slots 0 and 1 are never used, since those ids
+//	stand for the console (ConsoleInput and ConsoleOutput).
+//----------------------------------------------------------------------
+
+int
+AddrSpace::AddOpenFile(OpenFile *file)
+{
+    for (int id = 2; id < MaxOpenFiles; id++)
+	if (openFiles[id] == NULL) {
+	    openFiles[id] = file;
+	    return id;
+	}
+    return -1;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::FindOpenFile
+// 	Return the open file with the given OpenFileId, or NULL if there
+//	is none.
+//----------------------------------------------------------------------
+
+OpenFile *
+AddrSpace::FindOpenFile(int id)
+{
+    if (id < 0 || id >= MaxOpenFiles)
+	return NULL;
+    return openFiles[id];
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::CloseOpenFile
+// 	Close the open file with the given OpenFileId, and free its slot.
+//	Return FALSE if there is no such file.
+//----------------------------------------------------------------------
+
+bool
+AddrSpace::CloseOpenFile(int id)
+{
+    OpenFile *file = FindOpenFile(id);
+
+    if (file == NULL)
+	return FALSE;
+    delete file;
+    openFiles[id] = NULL;
+    return TRUE;
+}
@@ -18,6 +18,8 @@
 //+++++++++++++++++++#include "system.h"不能有这个包否则会编译错误，可以在addrspace.cc中导入
 
 #define UserStackSize		1024 	// 必要时增加此值！
+#define MaxOpenFiles		16	// open files per process, counting
+					// the console input and output
 
 class AddrSpace {
 
@@ -30,6 +32,17 @@ class AddrSpace {
     void SaveState();			// 保存/还原特定地址空间
     void RestoreState();		// 上下文切换的信息
 
+    int UserSpan(int virtAddr, int size, bool writing, char **span);
+					// locate the part of a user buffer
+					// that lies within one page
+    int CopyInString(int virtAddr, char *buf, int size);
+					// copy a string argument of a
+					// system call into the kernel
+
+    int AddOpenFile(OpenFile *file);	// the per-process open-file table,
+    OpenFile *FindOpenFile(int id);	// indexed by OpenFileId
+    bool CloseOpenFile(int id);
+
     //+++++++++在这里定义的原因是在addrspace.cc中定义显示spaceID非法
     int getSpaceID(){
         return spaceID;
@@ -80,6 +93,7 @@ class AddrSpace {
     //++++++++++++cl add++++++++++++
     OpenFile *executable;   // code segment & initData segment
     OpenFile *swapFile;     // uninitData segment & 
+    char swapName[16];      // "SWAP<spaceID>"
     NoffHeader noffH;
 
     int usedFrame;        // 已经使用的帧数
@@ -96,6 +110,8 @@ class AddrSpace {
     std::queue<int> comeQueue;
     //++++++++++++cl add++++++++++++
 
+    OpenFile *openFiles[MaxOpenFiles];	// NULL if the slot is free
+
 
 };
 
@@ -31,6 +31,163 @@ void AdvancePC(){
 }
 //+++++++++++++++++++++++++++++++++++++++++++++++++++
 
+//----------------------------------------------------------------------
+// The system call table.  Each system call is carried out by a method
+// of Interrupt; the table, indexed by the code in syscall.h, says which,
+// and how to describe the call when tracing it.  A code with no entry
+// (Fork, Yield) is an unexpected exception.
+//----------------------------------------------------------------------
+
+static void DoHalt() { interrupt->Halt(); }
+static void DoExit() { interrupt->Exit(); }
+static void DoExec() { interrupt->Exec(); }
+static void DoJoin() { interrupt->Join(); }
+static void DoCreate() { interrupt->Create(); }
+static void DoOpen() { interrupt->Open(); }
+static void DoRead() { interrupt->Read(); }
+static void DoWrite() { interrupt->Write(); }
+static void DoClose() { interrupt->Close(); }
+static void DoPrintInt() { interrupt->PrintInt(); }
+static void DoSleep() { interrupt->Sleep(); }
+
+struct Syscall {
+    const char *name;
+    void (*handler)();			// NULL if not implemented
+    int args;				// # of arguments, in r4..r7
+    bool nameArg;			// is r4 a string?
+    bool result;			// is anything returned in r2?
+    bool returns;			// FALSE for Halt and Exit
+};
+
+#define NumSyscalls	(SC_Sleep + 1)
+
+static Syscall syscalls[NumSyscalls] = {
+    { "Halt",	  DoHalt,	0, FALSE, FALSE, FALSE },	// SC_Halt
+    { "Exit",	  DoExit,	1, FALSE, FALSE, FALSE },	// SC_Exit
+    { "Exec",	  DoExec,	1, TRUE,  TRUE,  TRUE },	// SC_Exec
+    { "Join",	  DoJoin,	1, FALSE, TRUE,  TRUE },	// SC_Join
+    { "Create",	  DoCreate,	1, TRUE,  TRUE,  TRUE },	// SC_Create
+    { "Open",	  DoOpen,	1, TRUE,  TRUE,  TRUE },	// SC_Open
+    { "Read",	  DoRead,	3, FALSE, TRUE,  TRUE },	// SC_Read
+    { "Write",	  DoWrite,	3, FALSE, FALSE, TRUE },	// SC_Write
+    { "Close",	  DoClose,	1, FALSE, FALSE, TRUE },	// SC_Close
+    { "Fork",	  NULL,		1, FALSE, FALSE, TRUE },	// SC_Fork
+    { "Yield",	  NULL,		0, FALSE, FALSE, TRUE },	// SC_Yield
+    { "PrintInt", DoPrintInt,	1, FALSE, FALSE, TRUE },	// SC_PrintInt
+    { "Sleep",	  DoSleep,	1, FALSE, FALSE, TRUE },	// SC_Sleep
+};
+
+//----------------------------------------------------------------------
+// Syscall tracing, turned on by "nachos -st".  Every system call is
+// logged as it returns, strace-style, with the SpaceId of the process
+// making it:
+//
+//	[1] Open("data") = 2  <120 ticks, 3400 ns>
+//
+// (Halt and Exit don't return, so they are logged as they are made.)
+// The calls of each kind are also counted, along with the simulated
+// ticks and real (host) time they take, for SyscallStatsPrint to
+// print when Nachos halts.  The ticks include any time the caller
+// spends blocked, in Join or Sleep, say, while other threads run.
+//----------------------------------------------------------------------
+
+bool syscallTracing = FALSE;		// set by "nachos -st"
+
+struct SyscallStats {
+    int calls;
+    int ticks;
+    double hostTime;			// nanoseconds
+};
+
+static SyscallStats syscallStats[NumSyscalls];
+
+//----------------------------------------------------------------------
+// TraceArgs
+// 	Describe the arguments of the system call "call", as it is being
+//	made, into "buf", which holds "size" bytes.
+//----------------------------------------------------------------------
+
+static void
+TraceArgs(Syscall *call, char *buf, int size)
+{
+    char name[64];
+    int len = 0;
+
+    buf[0] = '\0';
+    for (int i = 0; i < call->args && len < size; i++) {
+	int arg = machine->ReadRegister(4 + i);
+
+	if (i == 0 && call->nameArg) {
+	    if (currentThread->space->CopyInString(arg, name, sizeof(name)) < 0)
+		strcpy(name, "...");
+	    len += snprintf(buf + len, size - len, "\"%s\"", name);
+	} else
+	    len += snprintf(buf + len, size - len, "%s%d", i ? ", " : "", arg);
+    }
+}
+
+//----------------------------------------------------------------------
+// TraceSyscall
+// 	Carry out the system call "type", tracing it as described above.
+//----------------------------------------------------------------------
+
+static void
+TraceSyscall(int type)
+{
+    Syscall *call = &syscalls[type];
+    SyscallStats *s = &syscallStats[type];
+    int id = currentThread->space->getSpaceID();
+    char args[128];
+    int startTicks;
+    double startTime;
+
+    TraceArgs(call, args, sizeof(args));
+    s->calls++;
+    if (!call->returns) {
+	printf("[%d] %s(%s) = ?\n", id, call->name, args);
+	fflush(stdout);
+    }
+
+    startTicks = stats->totalTicks;
+    startTime = HostTime();
+    (*call->handler)();
+    startTime = HostTime() - startTime;
+    startTicks = stats->totalTicks - startTicks;
+
+    s->ticks += startTicks;
+    s->hostTime += startTime;
+    if (call->result)
+	printf("[%d] %s(%s) = %d  <%d ticks, %.0f ns>\n", id, call->name, args,
+		machine->ReadRegister(2), startTicks, startTime);
+    else
+	printf("[%d] %s(%s)  <%d ticks, %.0f ns>\n", id, call->name, args,
+		startTicks, startTime);
+}
+
+//----------------------------------------------------------------------
+// SyscallStatsPrint
+// 	Print, for each system call that was made, how often it was made
+//	and the time it took, in all and on average.
+//----------------------------------------------------------------------
+
+void
+SyscallStatsPrint()
+{
+    SyscallStats *s;
+
+    printf("System calls:\n");
+    printf("%-9s %8s %10s %10s %14s %12s\n", "call", "calls", "ticks",
+		"avg", "host ns", "avg");
+    for (int type = 0; type < NumSyscalls; type++) {
+	s = &syscallStats[type];
+	if (s->calls == 0)
+	    continue;
+	printf("%-9s %8d %10d %10d %14.0f %12.0f\n", syscalls[type].name,
+		s->calls, s->ticks, s->ticks / s->calls, s->hostTime,
+		s->hostTime / s->calls);
+    }
+}
+
 //----------------------------------------------------------------------
 // ExceptionHandler
 // 	Nachos内核的入口点. 当用户程序正在执行时调用，并执行系统调用或生成寻址或算术异常。
@@ -48,6 +205,8 @@ void AdvancePC(){
 //
 //  返回前别忘了增加pc。（否则，您将永远循环进行相同的系统调用！
 //
+//	System calls are dispatched through the table above.
+//
 //	"which" is the kind of exception.  The list of possible exceptions 
 //	are in machine.h.
 //----------------------------------------------------------------------
@@ -56,26 +215,18 @@ void ExceptionHandler(ExceptionType which)
 {
     int type = machine->ReadRegister(2);
 
-    if ((which == SyscallException) && (type == SC_Halt)) {
-	DEBUG('a', "Shutdown, initiated by user program.\n");
-   	interrupt->Halt();
-    }
-    //+++++++++++++++++++实现系统调用Exec()的判断
-    else if((which == SyscallException) && (type == SC_Exec)) {
-        //原本将Exec()内容写在此处，但参考Halt()的实现，应该写在中断处理中
-        interrupt->Exec();
-        //推进PC值
-        AdvancePC();
-        return;
-    }
-    //++++++++++++++++++++++++++需要实现系统调用PrintInt(int t)的判断
-    else if((which == SyscallException) && (type == SC_PrintInt)){
-        interrupt->PrintInt();
-        //推进PC值
+    if ((which == SyscallException) && (type >= 0) && (type < NumSyscalls)
+				&& (syscalls[type].handler != NULL)) {
+	if (type == SC_Halt)
+	    DEBUG('a', "Shutdown, initiated by user program.\n");
+	if (syscallTracing)
+	    TraceSyscall(type);
+	else
+	    (*syscalls[type].handler)();
+        //推进PC值 (Halt and Exit never get here)
         AdvancePC();
         return;
     }
-    //+++++++++++++++++++++++++++++++++++++++++++
 
     //++++++++++++cl add++++++++++++
     else if (which == PageFaultException) {
@@ -35,7 +35,7 @@ StartProcess(char *filename)
     currentThread->space = space;
 
 
-    // delete executable;			// close file
+    // the address space keeps the executable open, to page it in
 
     space->InitRegisters();		// set the initial register values
     space->RestoreState();		// load page table register
@@ -7,6 +7,8 @@
 
 #include "copyright.h"
 #include "system.h"
+#include "synchstats.h"
+#include "lockcheck.h"
 
 // This defines *all* of the global data structures used by Nachos.
 // These are all initialized and de-allocated by this file.
@@ -16,10 +18,12 @@ Thread *threadToBeDestroyed;  		// the thread that just finished
 Scheduler *scheduler;			// the ready list
 Interrupt *interrupt;			// interrupt status
 Statistics *stats;			// performance metrics
+Alarm *alarmClock;			// wakes up sleeping threads
 Timer *timer;				// the hardware timer device,for invoking context switches
 //+++++++++使用ThreadMap管理线程编号
 BitMap *ThreadMap;
 //++++++++++++
+Process *processTable[MAX_USERPROCESS];	// processes started by Exec
 
 
 #ifdef FILESYS_NEEDED
@@ -39,6 +43,9 @@ PostOffice *postOffice;
 #endif
 
 
+static char *synchProfileFile = NULL;	// where to print the counts
+					// kept by "-lp"
+
 // External definition, to allow us to take a pointer to this function
 extern void Cleanup();
 
@@ -114,10 +121,19 @@ Initialize(int argc, char **argv)
 						// number generator
 	    randomYield = TRUE;
 	    argCount = 2;
-	}
+	} else if (!strcmp(*argv, "-lp")) {
+	    synchProfiling = TRUE;		// profile synchronization
+	    if (argc > 1 && **(argv + 1) != '-') {
+		synchProfileFile = *(argv + 1);
+		argCount = 2;
+	    }
+	} else if (!strcmp(*argv, "-lc"))
+	    lockChecking = TRUE;		// look for deadlocks
 #ifdef USER_PROGRAM
 	if (!strcmp(*argv, "-s"))
 	    debugUserProg = TRUE;
+	else if (!strcmp(*argv, "-st"))
+	    syscallTracing = TRUE;		// trace system calls
 #endif
 #ifdef FILESYS_NEEDED
 	if (!strcmp(*argv, "-f"))
@@ -144,6 +160,7 @@ Initialize(int argc, char **argv)
     stats = new Statistics();			// collect statistics
     interrupt = new Interrupt;			// start up interrupt handling
     scheduler = new Scheduler();		// initialize the ready queue
+    alarmClock = new Alarm;			// ... and the sleep queue
     if (randomYield)				// start the timer (if needed)
 	timer = new Timer(TimerInterruptHandler, 0, randomYield);
 
@@ -183,6 +200,12 @@ void
 Cleanup()
 {
     printf("\nCleaning up...\n");
+    if (synchProfiling)
+	SynchStatsPrint(synchProfileFile);
+#ifdef USER_PROGRAM
+    if (syscallTracing)
+	SyscallStatsPrint();
+#endif
 
 #ifdef NETWORK
     delete postOffice;
@@ -203,6 +226,7 @@ Cleanup()
     delete ThreadMap;
     //+++++++++++++++++++++++
     delete timer;
+    delete alarmClock;
     delete scheduler;
     delete interrupt;
     
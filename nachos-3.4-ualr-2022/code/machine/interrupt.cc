@@ -22,13 +22,14 @@
 
 #include "copyright.h"
 #include "interrupt.h"
+#include "lockcheck.h"
 #include "system.h"
 
 // String definitions for debugging messages
 
 static const char *intLevelNames[] = { "off", "on"};
 static const char *intTypeNames[] = { "timer", "disk", "console write", 
-			"console read", "network send", "network recv"};
+			"console read", "network send", "network recv", "alarm"};
 
 //----------------------------------------------------------------------
 // PendingInterrupt::PendingInterrupt
@@ -228,6 +229,8 @@ Interrupt::Idle()
     // is not reached.  Instead, the halt must be invoked by the user program.
 
     DEBUG('i', "Machine idle.  No interrupts to do.\n");
+    if (lockChecking)
+	LockCheckIdle();		// any thread still asleep is stuck
     printf("No threads ready or runnable, and no pending interrupts.\n");
     printf("Assuming the program completed.\n");
     Halt();
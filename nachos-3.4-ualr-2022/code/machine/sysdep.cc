@@ -31,6 +31,7 @@ extern "C" {
 #include <signal.h>
 #include <sys/types.h>
 #include <sys/time.h>
+#include <time.h>
 #include <sys/socket.h>
 #include <sys/file.h>
 #include <sys/un.h>
@@ -495,6 +496,22 @@ Random()
     return rand();
 }
 
+//----------------------------------------------------------------------
+// HostTime
+// 	Return the time on the host's monotonic clock, in nanoseconds.
+//	This is real time, for measuring how fast Nachos itself runs;
+//	the simulated machine keeps its own time in "stats".
+//----------------------------------------------------------------------
+
+double
+HostTime()
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double) ts.tv_sec * 1e9 + (double) ts.tv_nsec;
+}
+
 //----------------------------------------------------------------------
 // AllocBoundedArray
 // 	Return an array, with the two pages just before 
@@ -51,6 +51,9 @@ extern void CallOnUserAbort(VoidNoArgFunctionPtr cleanUp);
 extern void RandomInit(unsigned seed);
 extern int Random();
 
+// Host (real) time in nanoseconds, for timing Nachos itself
+extern double HostTime();
+
 // Allocate, de-allocate an array, such that de-referencing
 // just beyond either end of the array will cause an error
 extern char *AllocBoundedArray(int size);
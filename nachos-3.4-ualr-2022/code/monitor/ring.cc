@@ -33,9 +33,10 @@ slot::slot(int id, int number)
 // 	return type.
 //
 // 	"sz" -- maximum number of elements in the ring buffer at any time
+//	"singlePair" -- only one producer and one consumer use the ring
 //----------------------------------------------------------------------
 
-Ring::Ring(int sz)
+Ring::Ring(int sz, bool singlePair)
 {
     if (sz < 1) {
 	fprintf(stderr, "Error: Ring: size %d too small\n", sz);
@@ -47,6 +48,7 @@ Ring::Ring(int sz)
     in = 0;
     out = 0;
     current = 0;
+    spsc = singlePair;
     buffer = new slot[size]; //allocate an array of slots.
 
     // Initialize condition variables
@@ -91,6 +93,13 @@ Ring::~Ring()
 void
 Ring::Put(slot *message)
 {
+    if (spsc && (current > 0) && (current < size)) {
+	buffer[in].thread_id = message->thread_id;	// fast path: no one
+	buffer[in].value = message->value;		// is waiting
+	current++;
+	in = (in + 1) % size;
+	return;
+    }
 
     mutex->P();
     
@@ -125,6 +134,13 @@ Ring::Put(slot *message)
 void
 Ring::Get(slot *message)
 {
+    if (spsc && (current > 0) && (current < size)) {
+	message->thread_id = buffer[out].thread_id;	// fast path: no one
+	message->value = buffer[out].value;		// is waiting
+	current--;
+	out = (out + 1) % size;
+	return;
+    }
 
     mutex->P();
 	
@@ -148,16 +164,97 @@ Ring::Get(slot *message)
 	mutex->V();
 }
 
+//----------------------------------------------------------------------
+// Ring::PutMany
+// 	Put "n" messages into the buffer, entering the monitor once.
+//	As many messages as there are empty slots are put in at a time,
+//	waking up consumers for them; if the buffer fills up, wait until
+//	there is room for the rest.
+//
+//	"messages" -- the n messages to be put in the buffer
+//----------------------------------------------------------------------
+
+void
+Ring::PutMany(slot *messages, int n)
+{
+    int i = 0;
+
+    mutex->P();
+
+    while (i < n) {
+	if (current == size) 
+	    notfull->Wait(mutex, next, &next_count);
+
+	for (; (i < n) && (current < size); i++) {
+	    buffer[in].thread_id = messages[i].thread_id;
+	    buffer[in].value = messages[i].value;
+	    current++;
+	    in = (in + 1) % size;
+	}
+	while ((current > 0) && (notempty->Waiting() > 0))
+	    notempty->Signal(next, &next_count);
+    }
+
+    if (next_count > 0) 
+	next->V();
+    else 
+	mutex->V();
+}
+
+//----------------------------------------------------------------------
+// Ring::GetMany
+// 	Get up to "max" messages from the buffer, entering the monitor
+//	once.  Wait only if the buffer is empty; then take as many messages
+//	as there are, up to "max", and wake up producers for the room.
+//
+//	Returns the number of messages taken.
+//
+//	"messages" -- where to put the messages
+//	"max" -- the most messages to take
+//----------------------------------------------------------------------
+
+int
+Ring::GetMany(slot *messages, int max)
+{
+    int i;
+
+    mutex->P();
+	
+    if (current == 0) 
+	notempty->Wait(mutex, next, &next_count);
+
+    for (i = 0; (i < max) && (current > 0); i++) {
+	messages[i].thread_id = buffer[out].thread_id;
+	messages[i].value = buffer[out].value;
+	current--;
+	out = (out + 1) % size;
+    }
+    while ((current < size) && (notfull->Waiting() > 0))
+	notfull->Signal(next, &next_count);
+
+    if (next_count > 0) 
+	next->V();
+    else 
+	mutex->V();
+    return i;
+}
+
+//----------------------------------------------------------------------
+// Ring::Empty, Ring::Full
+// 	As with semaphores, the answer may be out of date by the time the
+//	caller looks at it, unless the caller is inside the monitor.
+//----------------------------------------------------------------------
+
 int
 Ring::Empty()
 {
-return 0; // to be implemented
+    return current == 0;
 }
 
 int
 Ring::Full()
 {
-return 0; // to be implemented
+    return current == size;
 }
 
 
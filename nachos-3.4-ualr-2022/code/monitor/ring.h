@@ -12,6 +12,16 @@
 //
 // The constructor (initializer) for the ring burrer is passed with an
 // integer for the size of the buffer (the number of slots). 
+//
+// PutMany and GetMany move several slots per entry to the monitor.
+//
+// If the ring is only ever used by one producer thread and one consumer
+// thread, "singlePair" can be set, and then Put and Get do not enter the
+// monitor at all while the ring is neither full nor empty: no one can be
+// waiting in the monitor then, and the producer and the consumer work on
+// different slots.  This relies on Nachos running threads one at a time,
+// switching only when interrupts are re-enabled or a thread blocks; the
+// fast path does neither.
 
 // class of the slot in the ring-buffer
 
@@ -29,12 +39,18 @@ class slot {
 
 class Ring {
   public:
-    Ring(int sz);    // Constructor:  initialize variables, allocate space.
+    Ring(int sz, bool singlePair = FALSE);
+                     // Constructor:  initialize variables, allocate space.
     ~Ring();         // Destructor:   deallocate space allocated above.
     
     void Put(slot *message); // Put a message the next empty slot.
     
     void Get(slot *message); // Get a message from the next  full slot.
+
+    void PutMany(slot *messages, int n);
+                     // Put n messages, in as few turns as the room allows.
+    int GetMany(slot *messages, int max);
+                     // Get between 1 and max messages; return how many.
                                             
     int Full();       // Returns non-0 if the ring is full, 0 otherwise.
     int Empty();      // Returns non-0 if the ring is empty, 0 otherwise.
@@ -44,6 +60,7 @@ class Ring {
     int in, out;      // Index of Put and Get
     slot *buffer;       // A pointer to an array for the ring buffer.
     int current;      // the current number of full slots in the buffer
+    bool spsc;        // one producer and one consumer: use the fast path
 
     Condition_H *notfull; // condition variable to wait until not full
     Condition_H *notempty; // condition variable to wait until not empty
@@ -23,6 +23,7 @@
 
 #include "copyright.h"
 #include "synch.h"
+#include "lockcheck.h"
 #include "system.h"
 
 //----------------------------------------------------------------------
@@ -38,6 +39,7 @@ Semaphore::Semaphore(const char* debugName, int initialValue)
     name = (char*)debugName;
     value = initialValue;
     queue = new List;
+    profile = SynchStatsFind(debugName, "semaphore");
 }
 
 //----------------------------------------------------------------------
@@ -65,13 +67,26 @@ void
 Semaphore::P()
 {
     IntStatus oldLevel = interrupt->SetLevel(IntOff);	// disable interrupts
+    int start = stats->totalTicks;
+    bool waited = FALSE;
     
     while (value == 0) { 			// semaphore not available
+	if (lockChecking)
+	    LockCheckSleep("semaphore", name, __builtin_return_address(0));
 	queue->Append((void *)currentThread);	// so go to sleep
 	currentThread->Sleep();
+	waited = TRUE;
     } 
+    if (waited && lockChecking)
+	LockCheckAwake();
     value--; 					// semaphore available, 
 						// consume its value
+    if (profile != NULL) {
+	if (waited)
+	    profile->Waited(start);
+	else
+	    profile->Used();
+    }
     
     (void) interrupt->SetLevel(oldLevel);	// re-enable interrupts
 }
@@ -98,6 +113,23 @@ Semaphore::V()
 }
 
 
+//----------------------------------------------------------------------
+// Semaphore::Requeue
+// 	Put a thread that is already asleep on the queue of threads
+//	waiting in P(), as if it had called P() itself.  V() will wake it
+//	up in its turn, but it is the thread's job, once awake, to take
+//	the value that V() left for it, by calling P().
+//
+//	Called with interrupts disabled.
+//----------------------------------------------------------------------
+
+void
+Semaphore::Requeue(Thread *thread)
+{
+    ASSERT(interrupt->getLevel() == IntOff);
+    queue->Append((void *)thread);
+}
+
 //----------------------------------------------------------------------
 // Lock::Lock
 // 	Initialize a lock, so that it can be used for synchronization.
@@ -110,7 +142,8 @@ Lock::Lock(const char* debugName)
 {
     name = (char*)debugName;
     owner = NULL;
-    lock = new Semaphore(name,1);
+    queue = new List;
+    profile = SynchStatsFind(debugName, "lock");
 }
 
 
@@ -121,40 +154,85 @@ Lock::Lock(const char* debugName)
 //----------------------------------------------------------------------
 Lock::~Lock() 
 {
-    delete lock;
+    ASSERT(queue->IsEmpty());
+    if (lockChecking)
+	LockCheckDelete(this);
+    delete queue;
 }
 
 //----------------------------------------------------------------------
 // Lock::Acquire
-//      Use a binary semaphore to implement the lock.  Record which 
-//      thread acquired the lock in order to assure that only the
-//      same thread releases it.
+//      Take the lock if it is free; otherwise, wait in the queue until
+//      Release hands it to us.  Record which thread acquired the lock
+//      in order to assure that only the same thread releases it.
 //----------------------------------------------------------------------
 void Lock::Acquire() 
 {
     IntStatus oldLevel = interrupt->SetLevel(IntOff);  // disable interrupts
 
-    lock->P();                            // procure the semaphore
-    owner = currentThread;                // record the new owner of the lock
+    if (lockChecking)
+	LockCheckAcquire(this, name, __builtin_return_address(0));
+    if (owner == NULL) {
+	owner = currentThread;            // record the new owner of the lock
+	if (lockChecking)
+	    LockCheckOwner(this, currentThread);
+	acquiredAt = stats->totalTicks;
+	if (profile != NULL)
+	    profile->Used();
+    } else {
+	int start = stats->totalTicks;
+	queue->Append((void *)currentThread);
+	currentThread->Sleep();
+	ASSERT(owner == currentThread);   // Release gave us the lock
+	if (profile != NULL)
+	    profile->Waited(start);
+    }
     (void) interrupt->SetLevel(oldLevel); // re-enable interrupts
 }
 
 //----------------------------------------------------------------------
 // Lock::Release
-//      Set the lock to be free (i.e. vanquish the semaphore).  Check
-//      that the currentThread is allowed to release this lock.
+//      Set the lock to be free, or if any thread is waiting for it, make
+//      that thread the owner and wake it up.  Check that the 
+//      currentThread is allowed to release this lock.
 //----------------------------------------------------------------------
 void Lock::Release() 
 {
+    Thread *thread;
     IntStatus oldLevel = interrupt->SetLevel(IntOff);  // disable interrupts
 
     // Ensure: a) lock is BUSY  b) this thread is the same one that acquired it.
     ASSERT(currentThread == owner);        
-    owner = NULL;                          // clear the owner
-    lock->V();                             // vanquish the semaphore
+    if (profile != NULL)
+	profile->Held(acquiredAt);
+    thread = (Thread *)queue->Remove();
+    owner = thread;                        // hand over the lock, or clear
+					   // the owner
+    acquiredAt = stats->totalTicks;
+    if (lockChecking)
+	LockCheckOwner(this, thread);
+    if (thread != NULL)
+	scheduler->ReadyToRun(thread);
     (void) interrupt->SetLevel(oldLevel);
 }
 
+//----------------------------------------------------------------------
+// Lock::Enqueue
+//      Add a thread that is already asleep to the queue of threads
+//      waiting for the lock, just as if it had called Acquire().  The
+//      thread stays asleep until Release hands it the lock.  Used by
+//      Condition::Signal and Broadcast, which are called by the holder.
+//
+//      Called with interrupts disabled.
+//----------------------------------------------------------------------
+void Lock::Enqueue(Thread *thread)
+{
+    ASSERT(owner != NULL);
+    if (lockChecking)
+	LockCheckRequeue(this, name, thread);
+    queue->Append((void *)thread);
+}
+
 
 //----------------------------------------------------------------------
 // Lock::isHeldByCurrentThread
@@ -181,6 +259,7 @@ Condition::Condition(const char* debugName)
     name = (char*)debugName;
     queue = new List;
     lock = NULL;
+    profile = SynchStatsFind(debugName, "condition");
 }
 
 //----------------------------------------------------------------------
@@ -198,7 +277,9 @@ Condition::~Condition()
 // Condition::Wait
 //
 //      Release the lock, relinquish the CPU until signaled, then
-//      re-acquire the lock.
+//      re-acquire the lock.  Signal moves us to the queue of threads
+//      waiting for the lock, so by the time we are woken up, Release
+//      has already handed the lock back to us.
 //
 //      Pre-conditions:  currentThread is holding the lock; threads in
 //      the queue are waiting on the same lock.
@@ -206,22 +287,29 @@ Condition::~Condition()
 void Condition::Wait(Lock* conditionLock) 
 { 
     IntStatus oldLevel = interrupt->SetLevel(IntOff);
+    int start = stats->totalTicks;
 
     ASSERT(conditionLock->isHeldByCurrentThread());  // check pre-condition
     if(queue->IsEmpty()) {
 	lock = conditionLock;  // helps to enforce pre-condition
     } 
     ASSERT(lock == conditionLock); // another pre-condition
+    if (lockChecking)
+	LockCheckSleep("condition", name, __builtin_return_address(0));
     queue->Append(currentThread);  // add this thread to the waiting list
     conditionLock->Release();      // release the lock
     currentThread->Sleep();        // goto sleep
-    conditionLock->Acquire();      // awaken: re-acquire the lock
+    ASSERT(conditionLock->isHeldByCurrentThread()); // awaken: lock is ours
+    if (profile != NULL)
+	profile->Waited(start);
     (void) interrupt->SetLevel(oldLevel);
 }
 
 //----------------------------------------------------------------------
 // Condition::Signal
 //      Wake up a thread, if there are any waiting on the condition.
+//      Since we hold the lock, the thread could not run anyway; it is
+//      moved to the lock's queue, rather than to the ready list.
 //   
 //      Pre-conditions:  currentThread is holding the lock; threads in
 //      the queue are waiting on the same lock.
@@ -235,14 +323,16 @@ void Condition::Signal(Lock* conditionLock)
     if(!queue->IsEmpty()) {
 	ASSERT(lock == conditionLock);
 	nextThread = (Thread *)queue->Remove();
-	scheduler->ReadyToRun(nextThread);      // wake up the thread
+	conditionLock->Enqueue(nextThread);     // wake up the thread
     } 
     (void) interrupt->SetLevel(oldLevel);
 }
 
 //----------------------------------------------------------------------
 // Condition::Broadcast
-//      Wake up all threads waiting on the condition.   
+//      Wake up all threads waiting on the condition.  As with Signal,
+//      they are moved to the lock's queue, so that they run one at a
+//      time as the lock is handed from one to the next.
 //
 //      Pre-conditions:  currentThread is holding the lock; threads in
 //      the queue are waiting on the same lock.
@@ -256,36 +346,59 @@ void Condition::Broadcast(Lock* conditionLock)
     if(!queue->IsEmpty()) {
 	ASSERT(lock == conditionLock);
 	while( (nextThread = (Thread *)queue->Remove()) ) {
-	    scheduler->ReadyToRun(nextThread);  // wake up the thread
+	    conditionLock->Enqueue(nextThread); // wake up the thread
 	}
     } 
     (void) interrupt->SetLevel(oldLevel);
 }
 
 // condition variables in Hoare's style
+
+// A thread waiting on a Condition_H.  "viaNext" is set when Broadcast
+// moves the thread from the condition's queue to the monitor's "next"
+// semaphore.
+struct HoareWaiter {
+    Thread *thread;
+    bool viaNext;
+};
+
 Condition_H::Condition_H(const char* debugName) 
 { 
     name = (char *)debugName;
     count = 0;
-    sem = new Semaphore(name, 0); //uses the same name as cond var
-
+    queue = new List;
+    profile = SynchStatsFind(debugName, "condition");
 }
 Condition_H::~Condition_H() 
 { 
-    delete sem;
+    delete queue;
 }
 
 void Condition_H::Wait(Semaphore *mutex, Semaphore *next, int *next_countPtr)
 { 
+    HoareWaiter self;
     IntStatus oldLevel = interrupt->SetLevel(IntOff);
+    int start = stats->totalTicks;
     
+    self.thread = currentThread;
+    self.viaNext = FALSE;
     count++;
+    queue->Append((void *)&self);
     if (*next_countPtr > 0)
        next->V();
     else 
        mutex->V();
-    sem->P();
-    count--;
+    if (lockChecking)
+	LockCheckSleep("condition", name, __builtin_return_address(0));
+    currentThread->Sleep();
+    if (lockChecking)
+	LockCheckAwake();
+    if (self.viaNext) {		// woken by next->V(): take its value,
+	next->P();		// which never has to wait
+	(*next_countPtr)--;
+    }
+    if (profile != NULL)
+	profile->Waited(start);
 
     (void) interrupt->SetLevel(oldLevel);
 }
@@ -293,11 +406,14 @@ void Condition_H::Wait(Semaphore *mutex, Semaphore *next, int *next_countPtr)
 
 void Condition_H::Signal(Semaphore *next, int *next_countPtr)
 {
+    HoareWaiter *waiter;
     IntStatus oldLevel = interrupt->SetLevel(IntOff);
     if (count > 0) 
     {
+	waiter = (HoareWaiter *)queue->Remove();
+	count--;
 	(*next_countPtr)++;
-	sem->V();
+	scheduler->ReadyToRun(waiter->thread);
 	
 	next->P();
 	(*next_countPtr)--;
@@ -308,6 +424,22 @@ void Condition_H::Signal(Semaphore *next, int *next_countPtr)
 
 void Condition_H::Broadcast(Semaphore *next, int *next_countPtr)
 { 
-// not implemented
-}
+    HoareWaiter *first, *waiter;
+    IntStatus oldLevel = interrupt->SetLevel(IntOff);
+    if (count > 0) 
+    {
+	first = (HoareWaiter *)queue->Remove();
+	while ((waiter = (HoareWaiter *)queue->Remove()) != NULL) {
+	    waiter->viaNext = TRUE;	// runs after "first", before us
+	    (*next_countPtr)++;
+	    next->Requeue(waiter->thread);
+	}
+	count = 0;
+	(*next_countPtr)++;
+	scheduler->ReadyToRun(first->thread);
 
+	next->P();
+	(*next_countPtr)--;
+    }
+    (void) interrupt->SetLevel(oldLevel);
+}
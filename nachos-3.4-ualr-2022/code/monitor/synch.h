@@ -9,6 +9,8 @@
 //
 //	Note that all the synchronization objects take a "name" as
 //	part of the initialization.  This is solely for debugging purposes.
+//	The name is also what the counts are kept under, when profiling
+//	is turned on (see synchstats.h).
 //
 // Copyright (c) 1992-1993 The Regents of the University of California.
 // All rights reserved.  See copyright.h for copyright notice and limitation 
@@ -20,6 +22,7 @@
 #include "copyright.h"
 #include "thread.h"
 #include "list.h"
+#include "synchstats.h"
 
 
 // The following class defines a "semaphore" whose value is a non-negative
@@ -45,11 +48,15 @@ class Semaphore {
     
     void P();	 // these are the only operations on a semaphore
     void V();	 // they are both *atomic*
+
+    void Requeue(Thread *thread);	// queue up a thread that is 
+					// already asleep, as if in P()
     
   private:
     char* name;        // useful for debugging
     int value;         // semaphore value, always >= 0
     List *queue;       // threads waiting in P() for the value to be > 0
+    SynchStats *profile;	// counts, if profiling is on
 };
 
 // The following class defines a "lock".  A lock can be BUSY or FREE.
@@ -63,6 +70,9 @@ class Semaphore {
 // In addition, by convention, only the thread that acquired the lock
 // may release it.  As with semaphores, you can't read the lock value
 // (because the value might change immediately after you read it).  
+//
+// When the lock is released, it is handed directly to the first thread
+// waiting for it, if any.
 
 class Lock {
   public:
@@ -81,7 +91,13 @@ class Lock {
   private:
     char* name;				// for debugging
     Thread *owner;                      // remember who acquired the lock
-    Semaphore *lock;                    // use semaphore for the actual lock
+    List *queue;			// threads waiting in Acquire()
+    SynchStats *profile;		// counts, if profiling is on
+    int acquiredAt;			// when "owner" got the lock
+
+    friend class Condition;
+    void Enqueue(Thread *thread);	// make a sleeping thread wait for
+					// the lock, without waking it up
 };
 
 // The following class defines a "condition variable".  A condition
@@ -104,9 +120,13 @@ class Lock {
 //
 // In Nachos, condition variables are assumed to obey *Mesa*-style
 // semantics.  When a Signal or Broadcast wakes up another thread,
-// it simply puts the thread on the ready list, and it is the responsibility
-// of the woken thread to re-acquire the lock (this re-acquire is
-// taken care of within Wait()).  By contrast, some define condition
+// it does not run right away: it has to get the lock back first.
+// Rather than putting the thread on the ready list, to find the lock
+// still held and go back to sleep, Signal and Broadcast move it straight
+// onto the lock's queue of waiting threads (this is "wait morphing"); it
+// becomes runnable only when Release hands it the lock.  So a Broadcast
+// wakes the waiters one at a time, as the lock comes free, instead of
+// all of them at once.  By contrast, some define condition
 // variables according to *Hoare*-style semantics -- where the signalling
 // thread gives up control over the lock and the CPU to the woken thread,
 // which runs immediately and gives back control over the lock to the 
@@ -136,12 +156,19 @@ class Condition {
     List* queue;  // threads waiting on the condition
     Lock* lock;   // debugging aid:  used to check correctness of
                   // arguments to Wait, Signal and Broacast
+    SynchStats *profile;	// counts, if profiling is on
 };
 
 
 // Here, condition variables are implemented using Hoare's style. We
 //use semaphores to implement conditional variable. The algorithms is
 //given in page 195 of the textbook. -ptang (aug 1995)
+//
+// Broadcast hands the monitor to the first waiter, and queues the others
+// on "next", ahead of the signaller, without waking them: each is woken
+// in turn as the one before it leaves the monitor or waits again, and the
+// signaller goes last.  So the signaller gives up the monitor only once,
+// instead of once per waiter.
 
 class Condition_H {
   public:
@@ -157,13 +184,16 @@ class Condition_H {
 					// for semaphore next.
     void Signal(Semaphore *next, int *next_countPtr); 
     void Broadcast(Semaphore *next, int *next_countPtr); 
+    int Waiting() { return count; }	// # of threads waiting; only
+					// meaningful inside the monitor
 
   private:
     char* name;
     // plus some other stuff you'll need to define
 
-    Semaphore *sem; // semaphore for the waiting threads;
+    List *queue;     // the waiting threads;
     int  count;      // the number of waiting threads;
+    SynchStats *profile;	// counts, if profiling is on
 };
 
 #endif // SYNCH_H
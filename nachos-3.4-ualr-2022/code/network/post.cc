@@ -49,7 +49,7 @@ Mail::Mail(PacketHeader pktH, MailHeader mailH, char *msgData)
 
 MailBox::MailBox()
 { 
-    messages = new SynchList(); 
+    messages = new BoundedSynchList(MaxMailBoxMessages); 
 }
 
 //----------------------------------------------------------------------
@@ -88,6 +88,9 @@ PrintHeader(PacketHeader pktHdr, MailHeader mailHdr)
 //
 //	We need to reconstruct the Mail message (by concatenating the headers
 //	to the data), to simplify queueing the message on the SynchList.
+//	If the mailbox is full, the message is dropped: the postal worker,
+//	which delivers to every mailbox, must not wait for any one of them,
+//	and the network is unreliable anyway.
 //
 //	"pktHdr" -- source, destination machine ID's
 //	"mailHdr" -- source, destination mailbox ID's
@@ -99,9 +102,9 @@ MailBox::Put(PacketHeader pktHdr, MailHeader mailHdr, char *data)
 { 
     Mail *mail = new Mail(pktHdr, mailHdr, data); 
 
-    messages->Append((void *)mail);	// put on the end of the list of 
-					// arrived messages, and wake up 
-					// any waiters
+    if (!messages->TryAppend((void *)mail))	// put on the end of the list
+	delete mail;			// of arrived messages, and wake up
+					// any waiters -- if there's room
 }
 
 //----------------------------------------------------------------------
@@ -123,6 +126,36 @@ MailBox::Get(PacketHeader *pktHdr, MailHeader *mailHdr, char *data)
     Mail *mail = (Mail *) messages->Remove();	// remove message from list;
 						// will wait if list is empty
 
+    Unpack(mail, pktHdr, mailHdr, data);
+}
+
+//----------------------------------------------------------------------
+// MailBox::TryGet
+// 	Like Get, but never waits: returns FALSE if there are no messages
+//	in the mailbox, TRUE if one was returned.
+//----------------------------------------------------------------------
+
+bool 
+MailBox::TryGet(PacketHeader *pktHdr, MailHeader *mailHdr, char *data) 
+{ 
+    Mail *mail = (Mail *) messages->TryRemove();
+
+    if (mail == NULL)
+	return FALSE;
+    Unpack(mail, pktHdr, mailHdr, data);
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// MailBox::Unpack
+// 	Parse a message taken out of the mailbox into the packet header,
+//	mailbox header, and data, and discard it.
+//----------------------------------------------------------------------
+
+void 
+MailBox::Unpack(Mail *mail, PacketHeader *pktHdr, MailHeader *mailHdr, 
+								char *data) 
+{ 
     *pktHdr = mail->pktHdr;
     *mailHdr = mail->mailHdr;
     if (DebugIsEnabled('n')) {
@@ -322,6 +355,26 @@ PostOffice::Receive(int box, PacketHeader *pktHdr,
     ASSERT(mailHdr->length <= MaxMailSize);
 }
 
+//----------------------------------------------------------------------
+// PostOffice::TryReceive
+// 	Retrieve a message from a specific box if there is one, without
+//	waiting; lets a server thread poll several boxes in turn.
+//
+//	Returns TRUE if a message was retrieved.
+//----------------------------------------------------------------------
+
+bool
+PostOffice::TryReceive(int box, PacketHeader *pktHdr, 
+				MailHeader *mailHdr, char* data)
+{
+    ASSERT((box >= 0) && (box < numBoxes));
+
+    if (!boxes[box].TryGet(pktHdr, mailHdr, data))
+	return FALSE;
+    ASSERT(mailHdr->length <= MaxMailSize);
+    return TRUE;
+}
+
 //----------------------------------------------------------------------
 // PostOffice::IncomingPacket
 // 	Interrupt handler, called when a packet arrives from the network.
@@ -52,6 +52,11 @@ class MailHeader {
 
 #define MaxMailSize 	(MaxPacketSize - sizeof(MailHeader))
 
+// Most messages a mailbox holds; once a mailbox is full, more mail
+// for it is dropped, as if the network had lost it.
+
+#define MaxMailBoxMessages	32
+
 
 // The following class defines the format of an incoming/outgoing 
 // "Mail" message.  The message format is layered: 
@@ -81,13 +86,20 @@ class MailBox {
     ~MailBox();			// De-allocate mail box
 
     void Put(PacketHeader pktHdr, MailHeader mailHdr, char *data);
-   				// Atomically put a message into the mailbox
+   				// Atomically put a message into the mailbox,
+				// unless it is full
     void Get(PacketHeader *pktHdr, MailHeader *mailHdr, char *data); 
    				// Atomically get a message out of the 
 				// mailbox (and wait if there is no message 
 				// to get!)
+    bool TryGet(PacketHeader *pktHdr, MailHeader *mailHdr, char *data); 
+   				// Same, but return FALSE instead of
+				// waiting if there is no message
   private:
-    SynchList *messages;	// A mailbox is just a list of arrived messages
+    void Unpack(Mail *mail, PacketHeader *pktHdr, MailHeader *mailHdr,
+		char *data);	// Copy out a message and delete it
+    BoundedSynchList *messages;	// A mailbox is just a list of arrived 
+				// messages
 };
 
 // The following class defines a "Post Office", or a collection of 
@@ -117,6 +129,10 @@ class PostOffice {
 		MailHeader *mailHdr, char *data);
     				// Retrieve a message from "box".  Wait if
 				// there is no message in the box.
+    bool TryReceive(int box, PacketHeader *pktHdr, 
+		MailHeader *mailHdr, char *data);
+    				// Retrieve a message from "box", if there
+				// is one; return FALSE if not.
 
     void PostalDelivery();	// Wait for incoming messages, 
 				// and then put them in the correct mailbox
@@ -1,9 +1,14 @@
-//简单程序运行另一个用户程序
+//简单程序运行另一个用户程序，等它退出并检查它的退出状态
 #include "syscall.h"
 int main()
 {
     SpaceId pid;
+    int status;
     PrintInt(12345);
-    pid = Exec("../test/halt.noff");//如果打不开这个文件，请检查权限和文件名称
+    pid = Exec("../test/exit.noff");//如果打不开这个文件，请检查权限和文件名称
+    status = Join(pid);//exit.noff以Exit(7)退出
+    PrintInt(status);
+    if (status != 7)
+        PrintInt(-1);//Join没有拿到子进程的退出状态
     Halt();
-}
\ No newline at end of file
+}
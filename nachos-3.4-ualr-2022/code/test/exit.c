@@ -0,0 +1,15 @@
+/* exit.c
+ *	Simple program to test Exit and Join.
+ *
+ *	Just exit with status 7, for the parent (see exec.c) to pick up
+ *	through Join.
+ */
+
+#include "syscall.h"
+
+int
+main()
+{
+    Exit(7);
+    /* not reached */
+}
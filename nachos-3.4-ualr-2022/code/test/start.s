@@ -138,6 +138,14 @@ PrintInt:
 	j	$31
 	.end PrintInt
 
+	.globl Sleep
+	.ent	Sleep
+Sleep:
+	addiu $2,$0,SC_Sleep
+	syscall
+	j	$31
+	.end Sleep
+
 /* dummy function to keep gcc happy */
         .globl  __main
         .ent    __main
@@ -0,0 +1,171 @@
+// alarm.cc
+//	Routines to put threads to sleep on the timing wheel, and to
+//	wake them up when their time has come.
+//
+//	The wheel's clock, "turns", counts slots of AlarmTicks since the
+//	start of time; slot number "turns % AlarmSlots" holds the threads
+//	whose deadline is within the AlarmTicks up to "turns * AlarmTicks".
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "alarm.h"
+#include "system.h"
+
+// A thread asleep on the wheel.  It lives on the sleeping thread's
+// stack, since the thread isn't going anywhere until it is woken up.
+struct Sleeper {
+    Thread *thread;
+    int when;				// absolute deadline, in ticks
+};
+
+//----------------------------------------------------------------------
+// AlarmHandler
+// 	Interrupt handler for the alarm: turn the wheel.  "arg" is the
+//	Alarm, since a handler has to be a plain procedure.
+//----------------------------------------------------------------------
+
+static void
+AlarmHandler(_int arg)
+{
+    ((Alarm *)arg)->CallBack();
+}
+
+//----------------------------------------------------------------------
+// NextTurn
+// 	Return how long it is until the wheel next turns -- the next
+//	multiple of AlarmTicks.
+//----------------------------------------------------------------------
+
+static int
+NextTurn()
+{
+    return AlarmTicks - stats->totalTicks % AlarmTicks;
+}
+
+//----------------------------------------------------------------------
+// Alarm::Alarm
+// 	Initialize the timing wheel, with no one asleep.  The interrupt
+//	is not scheduled until someone goes to sleep.
+//----------------------------------------------------------------------
+
+Alarm::Alarm()
+{
+    for (int i = 0; i < AlarmSlots; i++)
+	wheel[i] = new List;
+    sleepers = 0;
+    turns = 0;
+    ticking = FALSE;
+}
+
+//----------------------------------------------------------------------
+// Alarm::~Alarm
+// 	De-allocate the timing wheel.  Any threads still on it are never
+//	woken up, which is all right, since Nachos is halting.
+//----------------------------------------------------------------------
+
+Alarm::~Alarm()
+{
+    for (int i = 0; i < AlarmSlots; i++)
+	delete wheel[i];
+}
+
+//----------------------------------------------------------------------
+// Alarm::WaitUntil
+// 	Put the current thread to sleep until "howLong" ticks from now.
+//	It is woken up at the first turn of the wheel after that, and
+//	then waits its turn on the ready list, so it may sleep up to
+//	AlarmTicks longer, and more if the CPU is busy.
+//
+//	"howLong" is the number of ticks to sleep; if it is not positive,
+//		return immediately.
+//----------------------------------------------------------------------
+
+void
+Alarm::WaitUntil(int howLong)
+{
+    Sleeper self;
+    int slot;
+
+    if (howLong <= 0)
+	return;
+
+    IntStatus oldLevel = interrupt->SetLevel(IntOff);
+
+    self.thread = currentThread;
+    self.when = stats->totalTicks + howLong;
+    if (!ticking) {			// start the wheel turning
+	turns = stats->totalTicks / AlarmTicks;
+	interrupt->Schedule(AlarmHandler, (_int)this, NextTurn(), AlarmInt);
+	ticking = TRUE;
+    }
+    slot = divRoundUp(self.when, AlarmTicks) % AlarmSlots;
+    DEBUG('t', "Thread \"%s\" sleeping until %d\n", currentThread->getName(),
+					self.when);
+    wheel[slot]->SortedInsert((void *)&self, self.when);
+    sleepers++;
+    currentThread->Sleep();
+
+    (void) interrupt->SetLevel(oldLevel);
+}
+
+//----------------------------------------------------------------------
+// Alarm::Expire
+// 	Wake up the threads in "slot" whose deadline is no later than
+//	"now".  They are at the front, since the slot is sorted.
+//----------------------------------------------------------------------
+
+void
+Alarm::Expire(List *slot, int now)
+{
+    Sleeper *sleeper;
+    int when;
+
+    while ((sleeper = (Sleeper *)slot->SortedRemove(&when)) != NULL) {
+	if (when > now) {		// due on a later turn: put it back
+	    slot->SortedInsert((void *)sleeper, when);
+	    return;
+	}
+	DEBUG('t', "Waking up thread \"%s\" at %d\n",
+			sleeper->thread->getName(), now);
+	scheduler->ReadyToRun(sleeper->thread);
+	sleepers--;
+    }
+}
+
+//----------------------------------------------------------------------
+// Alarm::CallBack
+// 	Called, with interrupts disabled, when the wheel is due to turn.
+//	Visit each slot from where the wheel last stopped up to the
+//	present -- normally one, but interrupts can be late -- waking up
+//	the threads whose time has come.  Then, if anyone is left asleep,
+//	schedule the next turn.
+//
+//	As with the timer, a thread we wake up should not have to wait
+//	for the running thread to give up the CPU of its own accord; so
+//	we ask for a context switch on return from the interrupt.
+//----------------------------------------------------------------------
+
+void
+Alarm::CallBack()
+{
+    int now = stats->totalTicks;
+    int target = now / AlarmTicks;
+    int asleep = sleepers;
+
+    if (target - turns > AlarmSlots)	// no need to go round twice
+	turns = target - AlarmSlots;
+    while (turns < target) {
+	turns++;
+	Expire(wheel[turns % AlarmSlots], now);
+    }
+
+    if (sleepers < asleep && interrupt->getStatus() != IdleMode)
+	interrupt->YieldOnReturn();
+    if (sleepers > 0)
+	interrupt->Schedule(AlarmHandler, (_int)this, NextTurn(), AlarmInt);
+    else
+	ticking = FALSE;
+}
@@ -0,0 +1,62 @@
+// alarm.h
+//	Data structures for letting a thread sleep for a while.
+//
+//	A thread calls WaitUntil to give up the CPU for (at least) a given
+//	number of ticks.  Rather than polling, or keeping one list of all
+//	sleeping threads in order of their deadlines, sleeping threads are
+//	parked on a "timing wheel": a circular array of slots, each slot
+//	covering AlarmTicks of simulated time.  A thread is put in the slot
+//	where its deadline falls, and each time the wheel turns by a slot,
+//	the threads in that slot whose deadline has come are woken up.  A
+//	deadline more than one turn of the wheel away simply stays in its
+//	slot until the wheel comes round to it again.  So sleeping and
+//	waking take time proportional to the number of threads in one
+//	slot, not to the number asleep.
+//
+//	The wheel is turned by an interrupt (of type AlarmInt) every
+//	AlarmTicks, but only while some thread is asleep.  Being an
+//	AlarmInt and not a TimerInt, it also keeps Interrupt::Idle from
+//	halting the machine while every thread is asleep; instead, time
+//	skips ahead to the next turn of the wheel.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#ifndef ALARM_H
+#define ALARM_H
+
+#include "copyright.h"
+#include "utility.h"
+#include "list.h"
+#include "stats.h"
+
+#define AlarmSlots	64		// # of slots in the wheel
+#define AlarmTicks	TimerTicks	// simulated time covered by a slot
+
+// The following class defines the alarm clock: the timing wheel, and
+// the interrupt that turns it.
+
+class Alarm {
+  public:
+    Alarm();				// initialize an empty wheel
+    ~Alarm();				// de-allocate the wheel
+
+    void WaitUntil(int howLong);	// put the current thread to sleep
+					// for at least "howLong" ticks
+
+    void CallBack();			// called when the wheel turns
+
+  private:
+    List *wheel[AlarmSlots];		// sleeping threads, in the slot of
+					// their deadline, sorted by it
+    int sleepers;			// # of threads on the wheel
+    int turns;				// # of slots the wheel has turned,
+					// since the start of time
+    bool ticking;			// is the interrupt scheduled?
+
+    void Expire(List *slot, int now);	// wake up the threads in "slot"
+					// whose deadline has come
+};
+
+#endif // ALARM_H
@@ -0,0 +1,412 @@
+// lockcheck.cc
+//	Routines to keep the wait-for and lock-order graphs described in
+//	lockcheck.h, and to report deadlocks and lock-order inversions.
+//
+//	This is a debugging aid, so the graphs are kept as simple linked
+//	lists, searched from the start every time; the cost only matters
+//	with "-lc", and then is proportional to the number of locks.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "lockcheck.h"
+#include "system.h"
+
+#define MaxOrderPath	32	// longest inversion we print in full
+
+bool lockChecking = FALSE;		// set by "nachos -lc"
+
+struct LockNode;
+
+// An edge of the lock-order graph: thread "threadName" acquired lock
+// "to" at "site", while holding the lock the edge comes from, which it
+// had acquired at "heldSite".
+struct OrderEdge {
+    LockNode *to;
+    const char *threadName;
+    void *heldSite;
+    void *site;
+    OrderEdge *next;
+};
+
+// A lock that has been acquired at least once.
+struct LockNode {
+    void *lock;
+    const char *name;
+    Thread *owner;			// NULL if the lock is free
+    const char *ownerName;
+    void *site;				// where "owner" acquired it
+    OrderEdge *edges;			// locks acquired while holding it
+    int mark;				// visited, by the current OrderPath
+    LockNode *next;
+};
+
+// A thread that is waiting, or is about to.  "lock" is set if it is
+// waiting for a lock, which makes it part of the wait-for graph.
+struct Waiter {
+    Thread *thread;
+    const char *kind;			// "lock", "semaphore", "condition"
+    const char *name;
+    LockNode *lock;
+    void *site;				// where it called Acquire, P or Wait
+    Waiter *next;
+};
+
+static LockNode *allLocks = NULL;
+static Waiter *allWaiters = NULL;
+static int currentMark = 0;
+
+static OrderEdge *orderPath[MaxOrderPath];	// found by OrderPath
+static int orderPathLength;
+
+//----------------------------------------------------------------------
+// FindLock
+// 	Return the node for "lock"; if there is none, create one, unless
+//	"name" is NULL.
+//----------------------------------------------------------------------
+
+static LockNode *
+FindLock(void *lock, const char* name)
+{
+    LockNode *node;
+
+    for (node = allLocks; node != NULL; node = node->next)
+	if (node->lock == lock)
+	    return node;
+    if (name == NULL)
+	return NULL;
+    node = new LockNode;
+    node->lock = lock;
+    node->name = name;
+    node->owner = NULL;
+    node->ownerName = NULL;
+    node->site = NULL;
+    node->edges = NULL;
+    node->mark = 0;
+    node->next = allLocks;
+    allLocks = node;
+    return node;
+}
+
+//----------------------------------------------------------------------
+// FindWaiter, SetWaiter, RemoveWaiter
+// 	Look up, record, and forget what "thread" is waiting for.
+//----------------------------------------------------------------------
+
+static Waiter *
+FindWaiter(Thread *thread)
+{
+    Waiter *w;
+
+    for (w = allWaiters; w != NULL; w = w->next)
+	if (w->thread == thread)
+	    return w;
+    return NULL;
+}
+
+static void
+SetWaiter(Thread *thread, const char* kind, const char* name,
+				LockNode *lock, void *site)
+{
+    Waiter *w = FindWaiter(thread);
+
+    if (w == NULL) {
+	w = new Waiter;
+	w->thread = thread;
+	w->next = allWaiters;
+	allWaiters = w;
+    }
+    w->kind = kind;
+    w->name = name;
+    w->lock = lock;
+    w->site = site;
+}
+
+static void
+RemoveWaiter(Thread *thread)
+{
+    Waiter **prev, *w;
+
+    for (prev = &allWaiters; (w = *prev) != NULL; prev = &w->next)
+	if (w->thread == thread) {
+	    *prev = w->next;
+	    delete w;
+	    return;
+	}
+}
+
+//----------------------------------------------------------------------
+// OrderPath
+// 	Return TRUE if there is a path from "from" to "to" in the
+//	lock-order graph; if so, leave its edges, last first, in
+//	orderPath.  Each search marks the nodes it visits with a new
+//	value of currentMark, so that it visits each node once.
+//----------------------------------------------------------------------
+
+static bool
+Search(LockNode *from, LockNode *to)
+{
+    OrderEdge *e;
+
+    if (from == to)
+	return TRUE;
+    from->mark = currentMark;
+    for (e = from->edges; e != NULL; e = e->next)
+	if (e->to->mark != currentMark && Search(e->to, to)) {
+	    if (orderPathLength < MaxOrderPath)
+		orderPath[orderPathLength++] = e;
+	    return TRUE;
+	}
+    return FALSE;
+}
+
+static bool
+OrderPath(LockNode *from, LockNode *to)
+{
+    currentMark++;
+    orderPathLength = 0;
+    return Search(from, to);
+}
+
+//----------------------------------------------------------------------
+// ReportInversion
+// 	Report that the current thread, holding "held", is acquiring
+//	"node" at "site", while the lock-order graph -- as left in
+//	orderPath by OrderPath -- says that "node" has been held while
+//	(eventually) acquiring "held".
+//----------------------------------------------------------------------
+
+static void
+ReportInversion(LockNode *held, LockNode *node, void *site)
+{
+    LockNode *from = node;
+    OrderEdge *e;
+    int i;
+
+    printf("Lock check: lock order inversion\n");
+    printf("  thread \"%s\" acquires lock \"%s\" at %p, holding lock "
+	"\"%s\" (acquired at %p)\n", currentThread->getName(), node->name,
+	site, held->name, held->site);
+    printf("  but the locks have been taken in the other order:\n");
+    for (i = orderPathLength - 1; i >= 0; i--) {
+	e = orderPath[i];
+	printf("  thread \"%s\" acquired lock \"%s\" at %p, holding lock "
+	    "\"%s\" (acquired at %p)\n", e->threadName, e->to->name, e->site,
+	    from->name, e->heldSite);
+	from = e->to;
+    }
+    fflush(stdout);
+}
+
+//----------------------------------------------------------------------
+// CheckCycle
+// 	The current thread is about to wait for "node", which is held by
+//	another thread.  Follow the wait-for graph from the holder: if it
+//	leads back to the current thread, report the deadlock.
+//----------------------------------------------------------------------
+
+static void
+CheckCycle(LockNode *node)
+{
+    Thread *thread = node->owner;
+    Waiter *w;
+    int steps = 0, waiting = 0;
+
+    for (w = allWaiters; w != NULL; w = w->next)
+	waiting++;
+    while (thread != currentThread) {	// bounded, in case we reach a
+	w = FindWaiter(thread);		// cycle that does not include us
+	if (w == NULL || w->lock == NULL || ++steps > waiting)
+	    return;
+	thread = w->lock->owner;
+	if (thread == NULL)
+	    return;
+    }
+
+    printf("Lock check: deadlock\n");
+    do {
+	w = FindWaiter(thread);
+	printf("  thread \"%s\" waits at %p for lock \"%s\", held by thread "
+	    "\"%s\" (acquired at %p)\n", thread->getName(), w->site,
+	    w->lock->name, w->lock->ownerName, w->lock->site);
+	thread = w->lock->owner;
+    } while (thread != currentThread);
+    fflush(stdout);
+}
+
+//----------------------------------------------------------------------
+// LockCheckAcquire
+// 	Called at the start of Lock::Acquire, by the thread acquiring the
+//	lock.  For each lock the thread already holds, add an edge from it
+//	to this one to the lock-order graph, reporting an inversion if
+//	there is already a path the other way.  Then record that the
+//	thread is waiting for the lock -- until LockCheckOwner says it has
+//	it -- and if it is held, look for a cycle in the wait-for graph.
+//
+//	"lock" and "name" identify the lock
+//	"site" is the address Acquire was called from
+//----------------------------------------------------------------------
+
+void
+LockCheckAcquire(void *lock, const char* name, void *site)
+{
+    LockNode *node = FindLock(lock, name);
+    LockNode *held;
+    OrderEdge *e;
+
+    for (held = allLocks; held != NULL; held = held->next) {
+	if (held->owner != currentThread)
+	    continue;
+	if (held == node) {
+	    printf("Lock check: thread \"%s\" acquires lock \"%s\" at %p, "
+		"which it already holds (acquired at %p)\n",
+		currentThread->getName(), name, site, node->site);
+	    fflush(stdout);
+	    continue;
+	}
+	for (e = held->edges; e != NULL; e = e->next)
+	    if (e->to == node)
+		break;
+	if (e != NULL)
+	    continue;			// this order has been seen before
+	if (OrderPath(node, held))
+	    ReportInversion(held, node, site);
+	e = new OrderEdge;
+	e->to = node;
+	e->threadName = currentThread->getName();
+	e->heldSite = held->site;
+	e->site = site;
+	e->next = held->edges;
+	held->edges = e;
+    }
+
+    SetWaiter(currentThread, "lock", node->name, node, site);
+    if (node->owner != NULL && node->owner != currentThread)
+	CheckCycle(node);
+}
+
+//----------------------------------------------------------------------
+// LockCheckOwner
+// 	Record that "lock" has been acquired by "thread" -- either by
+//	Acquire, or by Release handing it over -- or that it is free, if
+//	"thread" is NULL.  The new owner is no longer waiting.
+//----------------------------------------------------------------------
+
+void
+LockCheckOwner(void *lock, Thread *thread)
+{
+    LockNode *node = FindLock(lock, NULL);
+    Waiter *w;
+
+    if (node == NULL)			// never acquired while checking
+	return;
+    node->owner = thread;
+    if (thread != NULL) {
+	w = FindWaiter(thread);
+	node->ownerName = thread->getName();
+	node->site = (w != NULL) ? w->site : NULL;
+	RemoveWaiter(thread);
+    }
+}
+
+//----------------------------------------------------------------------
+// LockCheckRequeue
+// 	Record that "thread", asleep on a condition variable, has been
+//	moved to the queue of "lock" by Signal or Broadcast.  If it gets
+//	the lock, it is said to acquire it where it called Wait.
+//----------------------------------------------------------------------
+
+void
+LockCheckRequeue(void *lock, const char* name, Thread *thread)
+{
+    LockNode *node = FindLock(lock, name);
+    Waiter *w = FindWaiter(thread);
+
+    SetWaiter(thread, "lock", node->name, node,
+				(w != NULL) ? w->site : NULL);
+}
+
+//----------------------------------------------------------------------
+// LockCheckDelete
+// 	Forget about a lock that is being deallocated, along with the
+//	edges of the lock-order graph that lead to it.
+//----------------------------------------------------------------------
+
+void
+LockCheckDelete(void *lock)
+{
+    LockNode **prev, *node, *other;
+    OrderEdge **eprev, *e;
+
+    for (prev = &allLocks; (node = *prev) != NULL; prev = &node->next)
+	if (node->lock == lock)
+	    break;
+    if (node == NULL)
+	return;
+    *prev = node->next;
+
+    for (other = allLocks; other != NULL; other = other->next)
+	for (eprev = &other->edges; (e = *eprev) != NULL; )
+	    if (e->to == node) {
+		*eprev = e->next;
+		delete e;
+	    } else
+		eprev = &e->next;
+    while ((e = node->edges) != NULL) {
+	node->edges = e->next;
+	delete e;
+    }
+    delete node;
+}
+
+//----------------------------------------------------------------------
+// LockCheckSleep, LockCheckAwake
+// 	Record that the current thread is going to wait on a semaphore or
+//	condition variable, called "name", because it called P or Wait
+//	from "site"; and that it is done waiting.
+//----------------------------------------------------------------------
+
+void
+LockCheckSleep(const char* kind, const char* name, void *site)
+{
+    SetWaiter(currentThread, kind, name, NULL, site);
+}
+
+void
+LockCheckAwake()
+{
+    RemoveWaiter(currentThread);
+}
+
+//----------------------------------------------------------------------
+// LockCheckIdle
+// 	Called when there is no thread to run and nothing more will
+//	happen.  If any thread is still waiting, say for what, and which
+//	locks are held; this is what a deadlock looks like from outside.
+//----------------------------------------------------------------------
+
+void
+LockCheckIdle()
+{
+    Waiter *w;
+    LockNode *node;
+
+    if (allWaiters == NULL)
+	return;
+    printf("Lock check: threads still waiting\n");
+    for (w = allWaiters; w != NULL; w = w->next)
+	if (w->lock != NULL && w->lock->owner != NULL)
+	    printf("  thread \"%s\" waits at %p for lock \"%s\", held by "
+		"thread \"%s\"\n", w->thread->getName(), w->site, w->name,
+		w->lock->ownerName);
+	else
+	    printf("  thread \"%s\" waits at %p on %s \"%s\"\n",
+		w->thread->getName(), w->site, w->kind, w->name);
+    for (node = allLocks; node != NULL; node = node->next)
+	if (node->owner != NULL)
+	    printf("  lock \"%s\" is held by thread \"%s\" (acquired at %p)\n",
+		node->name, node->ownerName, node->site);
+    fflush(stdout);
+}
@@ -0,0 +1,64 @@
+// lockcheck.h
+//	Data structures for finding deadlocks among threads.
+//
+//	When lock checking is turned on (with "nachos -lc"), the
+//	synchronization routines tell this module which thread holds
+//	which lock, and what each blocked thread is waiting for.  From
+//	that we keep two graphs:
+//
+//	  the wait-for graph -- a thread waiting for a lock points at
+//		the thread holding it.  A cycle is a deadlock; it is
+//		reported as soon as the thread closing it blocks.
+//
+//	  the lock-order graph -- there is an edge from lock A to lock
+//		B once some thread has acquired B while holding A.  If a
+//		thread then acquires A while holding B, the two threads
+//		could deadlock, whether or not they happen to this time;
+//		the inversion is reported when the second edge is added.
+//
+//	Reports name the threads and locks involved, and the places
+//	the locks were acquired -- the return address of the call to
+//	Acquire (or Wait, or P), which "addr2line -e nachos" can turn
+//	into a file and line.
+//
+//	Semaphores have no owner, so a thread waiting for one can't be
+//	part of a cycle we can see.  But every thread still blocked when
+//	the machine runs out of work (in Interrupt::Idle) is listed,
+//	with what it is waiting for, and the locks that are held.
+//
+//	All of the routines are called with interrupts disabled.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#ifndef LOCKCHECK_H
+#define LOCKCHECK_H
+
+#include "copyright.h"
+#include "thread.h"
+
+extern bool lockChecking;		// is lock checking turned on?
+
+extern void LockCheckAcquire(void *lock, const char* name, void *site);
+					// currentThread is acquiring "lock",
+					// called from "site"
+extern void LockCheckOwner(void *lock, Thread *thread);
+					// "lock" now belongs to "thread", or
+					// to no one, if it is NULL
+extern void LockCheckRequeue(void *lock, const char* name,
+					Thread *thread);
+					// a sleeping thread now waits for
+					// "lock" (Condition::Signal)
+extern void LockCheckDelete(void *lock);// "lock" is being deallocated
+
+extern void LockCheckSleep(const char* kind, const char* name,
+					void *site);
+					// currentThread is going to wait on a
+					// semaphore or condition variable
+extern void LockCheckAwake();		// ... and is done waiting
+
+extern void LockCheckIdle();		// report the threads that are
+					// still waiting
+
+#endif // LOCKCHECK_H
@@ -8,19 +8,25 @@
 //
 // 	Most of this file is not needed until later assignments.
 //
-// Usage: nachos -d <debugflags> -rs <random seed #>
+// Usage: nachos -d <debugflags> -rs <random seed #> -lp [profile file] -lc
 //		-s -x <nachos file> -c <consoleIn> <consoleOut>
 //		-f -cp <unix file> <nachos file>
 //		-p <nachos file> -r <nachos file> -l -D -t
 //              -n <network reliability> -e <network orderability>
 //              -m <machine id>
 //              -o <other machine id>
-//              -z
+//              -z -tb [iterations]
 //
 //    -d causes certain debugging messages to be printed (cf. utility.h)
 //    -rs causes Yield to occur at random (but repeatable) spots
+//    -lp profiles locks, semaphores and condition variables, printing
+//	the counts (to the file, if given) when Nachos halts
+//    -lc reports deadlocks and locks taken in inconsistent orders
 //    -z prints the copyright message
 //
+//  THREADS
+//    -tb times context switches, semaphores and thread creation
+//
 //  USER_PROGRAM
 //    -s causes user programs to be executed in single-step mode
 //    -x runs a user program
@@ -62,7 +68,7 @@ extern void ThreadTest(void), Copy(char *unixFile, char *nachosFile);
 extern void Print(char *file), PerformanceTest(void);
 extern void StartProcess(char *file), ConsoleTest(char *in, char *out);
 extern void MailTest(int networkID);
-extern void SynchTest(void);
+extern void SynchTest(void), ThreadBench(int iterations);
 
 //----------------------------------------------------------------------
 // main
@@ -98,6 +104,15 @@ main(int argc, char **argv)
 	argCount = 1;
         if (!strcmp(*argv, "-z"))               // print copyright
             printf ("%s", copyright);
+#ifdef THREADS
+        if (!strcmp(*argv, "-tb")) {		// benchmark the thread system
+	    if ((argc > 1) && (atoi(*(argv + 1)) > 0)) {
+		ThreadBench(atoi(*(argv + 1)));
+		argCount = 2;
+	    } else
+		ThreadBench(0);
+	}
+#endif // THREADS
 #ifdef USER_PROGRAM
         if (!strcmp(*argv, "-x")) {        	// run a user program
 	    ASSERT(argc > 1);
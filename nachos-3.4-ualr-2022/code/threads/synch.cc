@@ -23,6 +23,7 @@
 
 #include "copyright.h"
 #include "synch.h"
+#include "lockcheck.h"
 #include "system.h"
 
 //----------------------------------------------------------------------
@@ -38,6 +39,7 @@ Semaphore::Semaphore(const char* debugName, int initialValue)
     name = (char*)debugName;
     value = initialValue;
     queue = new List;
+    profile = SynchStatsFind(debugName, "semaphore");
 }
 
 //----------------------------------------------------------------------
@@ -65,13 +67,26 @@ void
 Semaphore::P()
 {
     IntStatus oldLevel = interrupt->SetLevel(IntOff);	// disable interrupts
+    int start = stats->totalTicks;
+    bool waited = FALSE;
     
     while (value == 0) { 			// semaphore not available
+	if (lockChecking)
+	    LockCheckSleep("semaphore", name, __builtin_return_address(0));
 	queue->Append((void *)currentThread);	// so go to sleep
 	currentThread->Sleep();
+	waited = TRUE;
     } 
+    if (waited && lockChecking)
+	LockCheckAwake();
     value--; 					// semaphore available, 
 						// consume its value
+    if (profile != NULL) {
+	if (waited)
+	    profile->Waited(start);
+	else
+	    profile->Used();
+    }
     
     (void) interrupt->SetLevel(oldLevel);	// re-enable interrupts
 }
@@ -110,9 +125,32 @@ Lock::Lock(const char* debugName)
 {
     name = (char*)debugName;
     owner = NULL;
-    lock = new Semaphore(name,1);
+    queue = new List;
+    profile = SynchStatsFind(debugName, "lock");
+#ifdef PRIORITY_INHERIT
+    ceiling = NoCeiling;
+    nextHeld = NULL;
+#endif
 }
 
+#ifdef PRIORITY_INHERIT
+//----------------------------------------------------------------------
+// Lock::Lock
+// 	Initialize a lock with a priority ceiling: whichever thread holds
+//	the lock runs at priority "priorityCeiling", if that is better
+//	than its own.
+//----------------------------------------------------------------------
+
+Lock::Lock(const char* debugName, int priorityCeiling) 
+{
+    name = (char*)debugName;
+    owner = NULL;
+    queue = new List;
+    profile = SynchStatsFind(debugName, "lock");
+    ceiling = priorityCeiling;
+    nextHeld = NULL;
+}
+#endif
 
 //----------------------------------------------------------------------
 // Lock::~Lock
@@ -121,40 +159,205 @@ Lock::Lock(const char* debugName)
 //----------------------------------------------------------------------
 Lock::~Lock() 
 {
-    delete lock;
+    ASSERT(queue->IsEmpty());
+    if (lockChecking)
+	LockCheckDelete(this);
+    delete queue;
 }
 
 //----------------------------------------------------------------------
 // Lock::Acquire
-//      Use a binary semaphore to implement the lock.  Record which 
-//      thread acquired the lock in order to assure that only the
-//      same thread releases it.
+//      Take the lock if it is free; otherwise, wait in the queue until
+//      Release hands it to us.  Record which thread acquired the lock
+//      in order to assure that only the same thread releases it.
+//
+//      With PRIORITY_INHERIT, a waiting thread lends its priority to
+//      the holder (see Lock::Reprioritize).
 //----------------------------------------------------------------------
 void Lock::Acquire() 
 {
     IntStatus oldLevel = interrupt->SetLevel(IntOff);  // disable interrupts
 
-    lock->P();                            // procure the semaphore
-    owner = currentThread;                // record the new owner of the lock
+    if (lockChecking)
+	LockCheckAcquire(this, name, __builtin_return_address(0));
+    if (owner == NULL) {
+	owner = currentThread;            // record the new owner of the lock
+	if (lockChecking)
+	    LockCheckOwner(this, currentThread);
+	acquiredAt = stats->totalTicks;
+	if (profile != NULL)
+	    profile->Used();
+#ifdef PRIORITY_INHERIT
+	nextHeld = currentThread->heldLocks;
+	currentThread->heldLocks = this;
+	Reprioritize(currentThread);	  // take on the ceiling, if any
+#endif
+    } else {
+	int start = stats->totalTicks;
+#ifdef PRIORITY_INHERIT
+	currentThread->waitingFor = this;
+	queue->SortedInsert((void *)currentThread, 
+					currentThread->getPriority());
+	Reprioritize(owner);		  // donate our priority
+#else
+	queue->Append((void *)currentThread);
+#endif
+	currentThread->Sleep();
+	ASSERT(owner == currentThread);   // Release gave us the lock
+	if (profile != NULL)
+	    profile->Waited(start);
+    }
     (void) interrupt->SetLevel(oldLevel); // re-enable interrupts
 }
 
 //----------------------------------------------------------------------
 // Lock::Release
-//      Set the lock to be free (i.e. vanquish the semaphore).  Check
-//      that the currentThread is allowed to release this lock.
+//      Set the lock to be free, or if any thread is waiting for it, make
+//      that thread the owner and wake it up.  Check that the 
+//      currentThread is allowed to release this lock.
 //----------------------------------------------------------------------
 void Lock::Release() 
 {
+    Thread *thread;
     IntStatus oldLevel = interrupt->SetLevel(IntOff);  // disable interrupts
 
     // Ensure: a) lock is BUSY  b) this thread is the same one that acquired it.
     ASSERT(currentThread == owner);        
-    owner = NULL;                          // clear the owner
-    lock->V();                             // vanquish the semaphore
+    if (profile != NULL)
+	profile->Held(acquiredAt);
+#ifdef PRIORITY_INHERIT
+    Lock **prev = &currentThread->heldLocks;
+    while (*prev != this)
+	prev = &(*prev)->nextHeld;
+    *prev = nextHeld;			   // no longer held by us ...
+    Reprioritize(currentThread);	   // ... so give back any donation
+#endif
+    thread = (Thread *)queue->Remove();
+    owner = thread;                        // hand over the lock, or clear
+					   // the owner
+    acquiredAt = stats->totalTicks;
+    if (lockChecking)
+	LockCheckOwner(this, thread);
+    if (thread != NULL) {
+#ifdef PRIORITY_INHERIT
+	thread->waitingFor = NULL;
+	nextHeld = thread->heldLocks;
+	thread->heldLocks = this;
+	Reprioritize(thread);		   // remaining waiters donate to it
+#endif
+	scheduler->ReadyToRun(thread);
+    }
     (void) interrupt->SetLevel(oldLevel);
 }
 
+//----------------------------------------------------------------------
+// Lock::Enqueue
+//      Add a thread that is already asleep to the queue of threads
+//      waiting for the lock, just as if it had called Acquire().  The
+//      thread stays asleep until Release hands it the lock.  Used by
+//      Condition::Signal and Broadcast, which are called by the holder.
+//
+//      Called with interrupts disabled.
+//----------------------------------------------------------------------
+void Lock::Enqueue(Thread *thread)
+{
+    ASSERT(owner != NULL);
+    if (lockChecking)
+	LockCheckRequeue(this, name, thread);
+#ifdef PRIORITY_INHERIT
+    thread->waitingFor = this;
+    queue->SortedInsert((void *)thread, thread->getPriority());
+    Reprioritize(owner);
+#else
+    queue->Append((void *)thread);
+#endif
+}
+
+#ifdef PRIORITY_INHERIT
+//----------------------------------------------------------------------
+// SortByPriority
+// 	Return a list holding the threads of "list", sorted by their 
+//	current priority.  Threads of equal priority stay in the same
+//	order.  "list" is deleted.
+//----------------------------------------------------------------------
+
+static List *
+SortByPriority(List *list)
+{
+    List *sorted = new List;
+    Thread *thread;
+
+    while ((thread = (Thread *)list->Remove()) != NULL)
+	sorted->SortedInsert((void *)thread, thread->getPriority());
+    delete list;
+    return sorted;
+}
+
+static int bestPriority;		// used by BestPriority
+
+static void
+BestPriority(_int arg)
+{
+    Thread *thread = (Thread *)arg;
+
+    if (thread->getPriority() < bestPriority)
+	bestPriority = thread->getPriority();
+}
+
+//----------------------------------------------------------------------
+// Lock::WaitingPriority
+// 	Return the best (smallest) priority of the threads waiting for
+//	the lock, or NoCeiling if there are none.
+//----------------------------------------------------------------------
+
+int
+Lock::WaitingPriority()
+{
+    bestPriority = NoCeiling;
+    queue->Mapcar(BestPriority);
+    return bestPriority;
+}
+
+//----------------------------------------------------------------------
+// Lock::Reprioritize
+// 	Recompute the priority a thread should be running at: its own
+//	priority, raised to the ceiling of each lock it holds and to the
+//	priority of each thread waiting for one of them.
+//
+//	If that changes the thread's priority, move it to its new place
+//	in the ready list, or in the queue of the lock it is waiting for;
+//	in the latter case, the holder of that lock has to be recomputed
+//	in turn, so donations are passed along a chain of waiting threads.
+//
+//	Called with interrupts disabled.
+//----------------------------------------------------------------------
+
+void
+Lock::Reprioritize(Thread *thread)
+{
+    int priority = thread->basePriority;
+    Lock *lock;
+
+    for (lock = thread->heldLocks; lock != NULL; lock = lock->nextHeld) {
+	if (lock->ceiling < priority)
+	    priority = lock->ceiling;
+	if (lock->WaitingPriority() < priority)
+	    priority = lock->WaitingPriority();
+    }
+    if (priority == thread->priority)
+	return;
+
+    DEBUG('t', "Thread \"%s\" priority %d -> %d\n", thread->getName(),
+				thread->priority, priority);
+    thread->priority = priority;
+    if (thread->getStatus() == READY)
+	scheduler->Resort();
+    else if ((lock = thread->waitingFor) != NULL) {
+	lock->queue = SortByPriority(lock->queue);
+	Reprioritize(lock->owner);
+    }
+}
+#endif // PRIORITY_INHERIT
 
 //----------------------------------------------------------------------
 // Lock::isHeldByCurrentThread
@@ -181,6 +384,7 @@ Condition::Condition(const char* debugName)
     name = (char*)debugName;
     queue = new List;
     lock = NULL;
+    profile = SynchStatsFind(debugName, "condition");
 }
 
 //----------------------------------------------------------------------
@@ -198,7 +402,9 @@ Condition::~Condition()
 // Condition::Wait
 //
 //      Release the lock, relinquish the CPU until signaled, then
-//      re-acquire the lock.
+//      re-acquire the lock.  Signal moves us to the queue of threads
+//      waiting for the lock, so by the time we are woken up, Release
+//      has already handed the lock back to us.
 //
 //      Pre-conditions:  currentThread is holding the lock; threads in
 //      the queue are waiting on the same lock.
@@ -206,22 +412,29 @@ Condition::~Condition()
 void Condition::Wait(Lock* conditionLock) 
 { 
     IntStatus oldLevel = interrupt->SetLevel(IntOff);
+    int start = stats->totalTicks;
 
     ASSERT(conditionLock->isHeldByCurrentThread());  // check pre-condition
     if(queue->IsEmpty()) {
 	lock = conditionLock;  // helps to enforce pre-condition
     } 
     ASSERT(lock == conditionLock); // another pre-condition
+    if (lockChecking)
+	LockCheckSleep("condition", name, __builtin_return_address(0));
     queue->Append(currentThread);  // add this thread to the waiting list
     conditionLock->Release();      // release the lock
     currentThread->Sleep();        // goto sleep
-    conditionLock->Acquire();      // awaken: re-acquire the lock
+    ASSERT(conditionLock->isHeldByCurrentThread()); // awaken: lock is ours
+    if (profile != NULL)
+	profile->Waited(start);
     (void) interrupt->SetLevel(oldLevel);
 }
 
 //----------------------------------------------------------------------
 // Condition::Signal
 //      Wake up a thread, if there are any waiting on the condition.
+//      Since we hold the lock, the thread could not run anyway; it is
+//      moved to the lock's queue, rather than to the ready list.
 //   
 //      Pre-conditions:  currentThread is holding the lock; threads in
 //      the queue are waiting on the same lock.
@@ -235,14 +448,16 @@ void Condition::Signal(Lock* conditionLock)
     if(!queue->IsEmpty()) {
 	ASSERT(lock == conditionLock);
 	nextThread = (Thread *)queue->Remove();
-	scheduler->ReadyToRun(nextThread);      // wake up the thread
+	conditionLock->Enqueue(nextThread);     // wake up the thread
     } 
     (void) interrupt->SetLevel(oldLevel);
 }
 
 //----------------------------------------------------------------------
 // Condition::Broadcast
-//      Wake up all threads waiting on the condition.   
+//      Wake up all threads waiting on the condition.  As with Signal,
+//      they are moved to the lock's queue, so that they run one at a
+//      time as the lock is handed from one to the next.
 //
 //      Pre-conditions:  currentThread is holding the lock; threads in
 //      the queue are waiting on the same lock.
@@ -256,8 +471,245 @@ void Condition::Broadcast(Lock* conditionLock)
     if(!queue->IsEmpty()) {
 	ASSERT(lock == conditionLock);
 	while( (nextThread = (Thread *)queue->Remove()) ) {
-	    scheduler->ReadyToRun(nextThread);  // wake up the thread
+	    conditionLock->Enqueue(nextThread); // wake up the thread
 	}
     } 
     (void) interrupt->SetLevel(oldLevel);
 }
+
+//----------------------------------------------------------------------
+// RWLock::RWLock
+// 	Initialize a readers/writer lock, so that it can be used for
+//	synchronization.  Nobody holds it initially.
+//
+//	"debugName" is an arbitrary name, useful for debugging.
+//	"pref" says whether waiting readers or writers go first.
+//----------------------------------------------------------------------
+
+RWLock::RWLock(const char* debugName, RWPreference pref)
+{
+    name = (char*)debugName;
+    preference = pref;
+    readers = 0;
+    writer = NULL;
+    readQueue = new List;
+    writeQueue = new List;
+}
+
+//----------------------------------------------------------------------
+// RWLock::~RWLock
+// 	De-allocate the lock.  Assume no one is holding or waiting for it.
+//----------------------------------------------------------------------
+
+RWLock::~RWLock()
+{
+    ASSERT((readers == 0) && (writer == NULL));
+    delete readQueue;
+    delete writeQueue;
+}
+
+//----------------------------------------------------------------------
+// RWLock::AcquireRead
+// 	Hold the lock shared.  Readers get in right away if no writer 
+//	holds the lock -- unless writers are preferred and one is waiting.
+//	Otherwise, wait until Grant hands us the lock.
+//----------------------------------------------------------------------
+
+void
+RWLock::AcquireRead()
+{
+    IntStatus oldLevel = interrupt->SetLevel(IntOff);
+
+    if ((writer == NULL) && 
+		((preference == PreferReaders) || writeQueue->IsEmpty()))
+	readers++;
+    else {
+	readQueue->Append((void *)currentThread);
+	currentThread->Sleep();		// Grant counted us in "readers"
+    }
+    (void) interrupt->SetLevel(oldLevel);
+}
+
+//----------------------------------------------------------------------
+// RWLock::ReleaseRead
+// 	Give up shared access; the last reader out hands the lock on.
+//----------------------------------------------------------------------
+
+void
+RWLock::ReleaseRead()
+{
+    IntStatus oldLevel = interrupt->SetLevel(IntOff);
+
+    ASSERT(readers > 0);
+    readers--;
+    if (readers == 0)
+	Grant();
+    (void) interrupt->SetLevel(oldLevel);
+}
+
+//----------------------------------------------------------------------
+// RWLock::AcquireWrite
+// 	Hold the lock exclusively, waiting until nobody else holds it.
+//----------------------------------------------------------------------
+
+void
+RWLock::AcquireWrite()
+{
+    IntStatus oldLevel = interrupt->SetLevel(IntOff);
+
+    if ((writer == NULL) && (readers == 0))
+	writer = currentThread;
+    else {
+	writeQueue->Append((void *)currentThread);
+	currentThread->Sleep();
+	ASSERT(writer == currentThread);	// Grant gave us the lock
+    }
+    (void) interrupt->SetLevel(oldLevel);
+}
+
+//----------------------------------------------------------------------
+// RWLock::ReleaseWrite
+// 	Give up exclusive access, and hand the lock on.
+//----------------------------------------------------------------------
+
+void
+RWLock::ReleaseWrite()
+{
+    IntStatus oldLevel = interrupt->SetLevel(IntOff);
+
+    ASSERT(writer == currentThread);
+    writer = NULL;
+    Grant();
+    (void) interrupt->SetLevel(oldLevel);
+}
+
+//----------------------------------------------------------------------
+// RWLock::isWriteHeldByCurrentThread
+//----------------------------------------------------------------------
+
+bool
+RWLock::isWriteHeldByCurrentThread()
+{
+    return writer == currentThread;
+}
+
+//----------------------------------------------------------------------
+// RWLock::Grant
+// 	The lock has just become free: give it to the first waiting writer,
+//	or to every waiting reader at once, according to the preference.
+//	The threads are woken up already holding the lock, so they need
+//	not compete for it again.
+//
+//	Called with interrupts disabled.
+//----------------------------------------------------------------------
+
+void
+RWLock::Grant()
+{
+    Thread *thread;
+
+    ASSERT((readers == 0) && (writer == NULL));
+    if (!writeQueue->IsEmpty() && 
+		((preference == PreferWriters) || readQueue->IsEmpty())) {
+	writer = (Thread *)writeQueue->Remove();
+	scheduler->ReadyToRun(writer);
+    } else {
+	while ((thread = (Thread *)readQueue->Remove()) != NULL) {
+	    readers++;
+	    scheduler->ReadyToRun(thread);
+	}
+    }
+}
+
+//----------------------------------------------------------------------
+// Barrier::Barrier
+// 	Initialize a barrier for "parties" threads.
+//
+//	"debugName" is an arbitrary name, useful for debugging.
+//----------------------------------------------------------------------
+
+Barrier::Barrier(const char* debugName, int numParties)
+{
+    ASSERT(numParties > 0);
+    name = (char*)debugName;
+    parties = numParties;
+    arrived = 0;
+    sense = 0;
+    queue = new List;
+}
+
+//----------------------------------------------------------------------
+// Barrier::~Barrier
+// 	De-allocate the barrier.  Assume no one is waiting at it.
+//----------------------------------------------------------------------
+
+Barrier::~Barrier()
+{
+    ASSERT(queue->IsEmpty());
+    delete queue;
+}
+
+//----------------------------------------------------------------------
+// Barrier::Arrive
+// 	Count the current thread as arrived, without waiting.  If it is the
+//	last one, end the phase: flip the sense, reset the count, and put
+//	every waiting thread on the ready list.
+//
+//	Returns the sense of the phase the thread arrived in, for WaitFor.
+//----------------------------------------------------------------------
+
+int
+Barrier::Arrive()
+{
+    Thread *thread;
+    int token;
+    IntStatus oldLevel = interrupt->SetLevel(IntOff);
+
+    token = sense;
+    arrived++;
+    if (arrived == parties) {
+	DEBUG('t', "Barrier \"%s\" phase over\n", name);
+	arrived = 0;
+	sense = !sense;
+	while ((thread = (Thread *)queue->Remove()) != NULL)
+	    scheduler->ReadyToRun(thread);
+    }
+    (void) interrupt->SetLevel(oldLevel);
+    return token;
+}
+
+//----------------------------------------------------------------------
+// Barrier::WaitFor
+// 	Wait until the phase in which Arrive() returned "token" is over.
+//	Returns at once if it already is.
+//----------------------------------------------------------------------
+
+void
+Barrier::WaitFor(int token)
+{
+    IntStatus oldLevel = interrupt->SetLevel(IntOff);
+
+    if (sense == token) {
+	queue->Append((void *)currentThread);
+	currentThread->Sleep();
+    }
+    (void) interrupt->SetLevel(oldLevel);
+}
+
+//----------------------------------------------------------------------
+// Barrier::Wait
+// 	Arrive at the barrier, and wait for everyone else to arrive.
+//	Returns TRUE if this thread was the last to arrive.
+//----------------------------------------------------------------------
+
+bool
+Barrier::Wait()
+{
+    IntStatus oldLevel = interrupt->SetLevel(IntOff);
+    int token = Arrive();
+    bool last = (sense != token);
+
+    WaitFor(token);
+    (void) interrupt->SetLevel(oldLevel);
+    return last;
+}
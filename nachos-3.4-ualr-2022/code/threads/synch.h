@@ -9,6 +9,8 @@
 //
 //	Note that all the synchronization objects take a "name" as
 //	part of the initialization.  This is solely for debugging purposes.
+//	The name is also what the counts are kept under, when profiling
+//	is turned on (see synchstats.h).
 //
 // Copyright (c) 1992-1993 The Regents of the University of California.
 // All rights reserved.  See copyright.h for copyright notice and limitation 
@@ -20,6 +22,7 @@
 #include "copyright.h"
 #include "thread.h"
 #include "list.h"
+#include "synchstats.h"
 
 
 // The following class defines a "semaphore" whose value is a non-negative
@@ -50,6 +53,7 @@ class Semaphore {
     char* name;  // useful for debugging
     int value;         // semaphore value, always >= 0
     List *queue;       // threads waiting in P() for the value to be > 0
+    SynchStats *profile;	// counts, if profiling is on
 };
 
 // The following class defines a "lock".  A lock can be BUSY or FREE.
@@ -63,10 +67,29 @@ class Semaphore {
 // In addition, by convention, only the thread that acquired the lock
 // may release it.  As with semaphores, you can't read the lock value
 // (because the value might change immediately after you read it).  
+//
+// When the lock is released, it is handed directly to the first thread
+// waiting for it, if any.
+//
+// With PRIORITY_INHERIT (which needs the priority scheduler of lab2),
+// waiting threads are queued by priority, and a thread holding a lock
+// runs at the best priority of the threads waiting for it -- following
+// the chain, if the holder is itself waiting for another lock -- so that
+// a low priority holder cannot keep a high priority thread waiting
+// behind threads of middling priority.  A lock may also be given a
+// priority ceiling: any thread holding it runs at that priority or better.
+
+#ifdef PRIORITY_INHERIT
+#define NoCeiling	0x7fffffff	// lock has no priority ceiling
+#endif
 
 class Lock {
   public:
     Lock(const char* debugName);  		// initialize lock to be FREE
+#ifdef PRIORITY_INHERIT
+    Lock(const char* debugName, int priorityCeiling);
+    					// ... with a priority ceiling
+#endif
     ~Lock();				// deallocate lock
     char* getName() { return name; }	// debugging assist
 
@@ -81,7 +104,22 @@ class Lock {
   private:
     char* name;				// for debugging
     Thread *owner;                      // remember who acquired the lock
-    Semaphore *lock;                    // use semaphore for the actual lock
+    List *queue;			// threads waiting in Acquire()
+    SynchStats *profile;		// counts, if profiling is on
+    int acquiredAt;			// when "owner" got the lock
+
+    friend class Condition;
+    void Enqueue(Thread *thread);	// make a sleeping thread wait for
+					// the lock, without waking it up
+#ifdef PRIORITY_INHERIT
+    int ceiling;			// priority ceiling, or NoCeiling
+    Lock *nextHeld;			// next lock held by "owner"
+
+    int WaitingPriority();		// best priority in "queue"
+    static void Reprioritize(Thread *thread);
+					// recompute thread's priority from
+					// the locks it holds
+#endif
 };
 
 // The following class defines a "condition variable".  A condition
@@ -104,9 +142,13 @@ class Lock {
 //
 // In Nachos, condition variables are assumed to obey *Mesa*-style
 // semantics.  When a Signal or Broadcast wakes up another thread,
-// it simply puts the thread on the ready list, and it is the responsibility
-// of the woken thread to re-acquire the lock (this re-acquire is
-// taken care of within Wait()).  By contrast, some define condition
+// it does not run right away: it has to get the lock back first.
+// Rather than putting the thread on the ready list, to find the lock
+// still held and go back to sleep, Signal and Broadcast move it straight
+// onto the lock's queue of waiting threads (this is "wait morphing"); it
+// becomes runnable only when Release hands it the lock.  So a Broadcast
+// wakes the waiters one at a time, as the lock comes free, instead of
+// all of them at once.  By contrast, some define condition
 // variables according to *Hoare*-style semantics -- where the signalling
 // thread gives up control over the lock and the CPU to the woken thread,
 // which runs immediately and gives back control over the lock to the 
@@ -136,5 +178,94 @@ class Condition {
     List* queue;  // threads waiting on the condition
     Lock* lock;   // debugging aid:  used to check correctness of
                   // arguments to Wait, Signal and Broacast
+    SynchStats *profile;	// counts, if profiling is on
+};
+// The following class defines a "readers/writer lock".  Any number of
+// threads (readers) may hold the lock shared at the same time, or a
+// single thread (the writer) may hold it exclusively.
+//
+//	AcquireRead / ReleaseRead -- wait until no writer holds the lock,
+//		then hold it shared
+//
+//	AcquireWrite / ReleaseWrite -- wait until no one holds the lock,
+//		then hold it exclusively
+//
+// When the lock becomes free, it is handed directly to the threads
+// waiting for it: either the first waiting writer, or all of the
+// waiting readers at once, which are put on the ready list together
+// already holding the lock.  Which are served first depends on the
+// preference given when the lock is created:
+//
+//	PreferWriters -- once a writer is waiting, new readers wait behind
+//		it, and a waiting writer goes before waiting readers
+//	PreferReaders -- readers get in whenever no writer holds the lock,
+//		and waiting readers go before a waiting writer
+//
+// Either way, a steady enough stream of one kind can starve the other.
+
+enum RWPreference { PreferWriters, PreferReaders };
+
+class RWLock {
+  public:
+    RWLock(const char* debugName, RWPreference pref = PreferWriters);
+    ~RWLock();
+    char* getName() { return name; }
+
+    void AcquireRead();			// shared access
+    void ReleaseRead();
+    void AcquireWrite();		// exclusive access
+    void ReleaseWrite();
+
+    bool isWriteHeldByCurrentThread();	// true if the current thread
+					// holds the lock exclusively
+
+  private:
+    char* name;
+    RWPreference preference;		// who goes first
+    int readers;			// # of threads holding it shared
+    Thread *writer;			// thread holding it exclusively
+    List *readQueue;			// threads waiting in AcquireRead
+    List *writeQueue;			// threads waiting in AcquireWrite
+
+    void Grant();			// hand a free lock to waiters
+};
+// The following class defines a "barrier": a meeting point for a fixed
+// number of threads ("parties").  Threads arriving at the barrier wait
+// until all of them have arrived; then all are released at once, and
+// the barrier is ready for the next phase.
+//
+//	Wait() -- arrive, and wait for the others.  Returns TRUE in exactly
+//		one thread per phase, the last to arrive, which does not wait.
+//
+//	Arrive() -- arrive, but do not wait; returns a token to pass to
+//		WaitFor() once the thread has done whatever else it can do
+//		in the meantime.
+//
+//	WaitFor(token) -- wait for the phase in which Arrive() returned
+//		"token" to be over.
+//
+// The barrier is "sense-reversing": it keeps a sense that flips at the
+// end of every phase, and a thread waits for the sense it arrived with
+// to change; so the count of arrivals can be reset for the next phase
+// without waiting for the slower threads to notice the last one has
+// gone through.  The last thread to arrive moves every waiting thread
+// onto the ready list itself, rather than each one waking the next.
+
+class Barrier {
+  public:
+    Barrier(const char* debugName, int parties);
+    ~Barrier();
+    char* getName() { return name; }
+
+    bool Wait();
+    int Arrive();
+    void WaitFor(int token);
+
+  private:
+    char* name;
+    int parties;			// # of threads that meet here
+    int arrived;			// # arrived in this phase
+    int sense;				// flips at the end of each phase
+    List *queue;			// threads waiting for the flip
 };
 #endif // SYNCH_H
@@ -14,6 +14,7 @@
 
 #include "copyright.h"
 #include "synchlist.h"
+#include "system.h"
 
 //----------------------------------------------------------------------
 // SynchList::SynchList
@@ -96,3 +97,314 @@ SynchList::Mapcar(VoidFunctionPtr func)
     list->Mapcar(func);
     lock->Release(); 
 }
+
+// A thread waiting in BoundedSynchList::Remove.  The record is shared
+// by the thread, the list's queue of removers, and (for RemoveTimeout)
+// the pending timeout interrupt; whichever is last to let go of it
+// deletes it.
+
+struct RemoveWaiter {
+    Thread *thread;
+    void *item;			// the item handed over, or NULL
+    bool done;			// handed an item, or timed out
+    int refs;			// # of references still held
+};
+
+// A thread waiting in BoundedSynchList::Append, for room for "item".
+
+struct AppendWaiter {
+    Thread *thread;
+    void *item;
+};
+
+static void
+DropWaiter(RemoveWaiter *waiter)
+{
+    if (--waiter->refs == 0)
+	delete waiter;
+}
+
+//----------------------------------------------------------------------
+// RemoveTimedOut
+// 	Interrupt handler for RemoveTimeout: if the thread is still
+//	waiting, wake it up empty-handed.  Its record stays on the list's
+//	queue of removers, marked done, until Put passes over it.
+//
+//	"arg" is the RemoveWaiter.
+//----------------------------------------------------------------------
+
+static void
+RemoveTimedOut(_int arg)
+{
+    RemoveWaiter *waiter = (RemoveWaiter *)arg;
+
+    if (!waiter->done) {
+	waiter->done = TRUE;
+	scheduler->ReadyToRun(waiter->thread);
+    }
+    DropWaiter(waiter);
+}
+
+//----------------------------------------------------------------------
+// BoundedSynchList::BoundedSynchList
+//	Initialize an empty bounded list, with room for "size" items.
+//----------------------------------------------------------------------
+
+BoundedSynchList::BoundedSynchList(int size)
+{
+    ASSERT(size > 0);
+    buffer = new void *[size];
+    capacity = size;
+    first = 0;
+    count = 0;
+    removers = new List;
+    appenders = new List;
+}
+
+//----------------------------------------------------------------------
+// BoundedSynchList::~BoundedSynchList
+//	De-allocate the list.  Threads that timed out in RemoveTimeout
+//	may have left their records behind; let go of those.
+//----------------------------------------------------------------------
+
+BoundedSynchList::~BoundedSynchList()
+{
+    RemoveWaiter *waiter;
+
+    while ((waiter = (RemoveWaiter *)removers->Remove()) != NULL) {
+	ASSERT(waiter->done);
+	DropWaiter(waiter);
+    }
+    ASSERT(appenders->IsEmpty());
+    delete removers;
+    delete appenders;
+    delete [] buffer;
+}
+
+//----------------------------------------------------------------------
+// BoundedSynchList::Put
+//	Hand "item" to the first thread still waiting in Remove, or if 
+//	there is none, add it to the end of the list -- waiting, if the
+//	list is full, until Take makes room for it.
+//
+//	Called with interrupts disabled.
+//----------------------------------------------------------------------
+
+void
+BoundedSynchList::Put(void *item)
+{
+    RemoveWaiter *remover;
+    AppendWaiter self;
+
+    ASSERT(item != NULL);
+    while ((remover = (RemoveWaiter *)removers->Remove()) != NULL) {
+	if (!remover->done) {
+	    remover->item = item;
+	    remover->done = TRUE;
+	    scheduler->ReadyToRun(remover->thread);
+	    DropWaiter(remover);
+	    return;
+	}
+	DropWaiter(remover);		// timed out, skip it
+    }
+    if (count == capacity) {
+	self.thread = currentThread;
+	self.item = item;
+	appenders->Append((void *)&self);
+	currentThread->Sleep();		// Take puts our item in the list
+	return;
+    }
+    buffer[(first + count) % capacity] = item;
+    count++;
+}
+
+//----------------------------------------------------------------------
+// BoundedSynchList::Take
+//	Remove the first item from the list, which must not be empty.
+//	If a thread is waiting in Append, its item goes in the slot that
+//	has just been freed, and it is woken up.
+//
+//	Called with interrupts disabled.
+//----------------------------------------------------------------------
+
+void *
+BoundedSynchList::Take()
+{
+    void *item;
+    AppendWaiter *appender;
+
+    ASSERT(count > 0);
+    item = buffer[first];
+    first = (first + 1) % capacity;
+    count--;
+    if ((appender = (AppendWaiter *)appenders->Remove()) != NULL) {
+	buffer[(first + count) % capacity] = appender->item;
+	count++;
+	scheduler->ReadyToRun(appender->thread);
+    }
+    return item;
+}
+
+//----------------------------------------------------------------------
+// BoundedSynchList::WaitForItem
+//	Wait, in an empty list, for Put to hand us an item.  If "ticks"
+//	is positive, give up after that many ticks.  Returns the item,
+//	or NULL if we gave up.
+//
+//	Called with interrupts disabled.
+//----------------------------------------------------------------------
+
+void *
+BoundedSynchList::WaitForItem(int ticks)
+{
+    RemoveWaiter *waiter = new RemoveWaiter;
+    void *item;
+
+    waiter->thread = currentThread;
+    waiter->item = NULL;
+    waiter->done = FALSE;
+    waiter->refs = 2;			// us, and "removers"
+    removers->Append((void *)waiter);
+    if (ticks > 0) {
+	waiter->refs++;			// and the timeout
+	interrupt->Schedule(RemoveTimedOut, (_int)waiter, ticks, AlarmInt);
+    }
+    currentThread->Sleep();
+    item = waiter->item;
+    DropWaiter(waiter);
+    return item;
+}
+
+//----------------------------------------------------------------------
+// BoundedSynchList::Append
+//      Append an "item" to the end of the list, waiting if the list is
+//	full.  Wake up anyone waiting for an item.
+//
+//	"item" is the thing to put on the list, it can be a pointer to 
+//		anything but NULL.
+//----------------------------------------------------------------------
+
+void
+BoundedSynchList::Append(void *item)
+{
+    IntStatus oldLevel = interrupt->SetLevel(IntOff);
+
+    Put(item);
+    (void) interrupt->SetLevel(oldLevel);
+}
+
+//----------------------------------------------------------------------
+// BoundedSynchList::TryAppend
+//      Append an "item" to the end of the list, if there is room for
+//	it (or someone waiting to take it).  Never waits; returns FALSE,
+//	leaving the list as it was, if the list is full.
+//----------------------------------------------------------------------
+
+bool
+BoundedSynchList::TryAppend(void *item)
+{
+    IntStatus oldLevel = interrupt->SetLevel(IntOff);
+    bool room = (count < capacity);
+
+    if (room)				// so Put won't wait
+	Put(item);
+    (void) interrupt->SetLevel(oldLevel);
+    return room;
+}
+
+//----------------------------------------------------------------------
+// BoundedSynchList::AppendBatch
+//      Append "n" items to the end of the list, in order, waiting
+//	whenever the list is full.
+//----------------------------------------------------------------------
+
+void
+BoundedSynchList::AppendBatch(void **items, int n)
+{
+    IntStatus oldLevel = interrupt->SetLevel(IntOff);
+
+    for (int i = 0; i < n; i++)
+	Put(items[i]);
+    (void) interrupt->SetLevel(oldLevel);
+}
+
+//----------------------------------------------------------------------
+// BoundedSynchList::Remove
+//      Remove an item from the beginning of the list, waiting if
+//	the list is empty.
+//----------------------------------------------------------------------
+
+void *
+BoundedSynchList::Remove()
+{
+    void *item;
+    IntStatus oldLevel = interrupt->SetLevel(IntOff);
+
+    if (count > 0)
+	item = Take();
+    else
+	item = WaitForItem(0);
+    (void) interrupt->SetLevel(oldLevel);
+    return item;
+}
+
+//----------------------------------------------------------------------
+// BoundedSynchList::TryRemove
+//      Remove an item from the beginning of the list, if there is one.
+//	Never waits; returns NULL if the list is empty.
+//----------------------------------------------------------------------
+
+void *
+BoundedSynchList::TryRemove()
+{
+    void *item = NULL;
+    IntStatus oldLevel = interrupt->SetLevel(IntOff);
+
+    if (count > 0)
+	item = Take();
+    (void) interrupt->SetLevel(oldLevel);
+    return item;
+}
+
+//----------------------------------------------------------------------
+// BoundedSynchList::RemoveTimeout
+//      Remove an item from the beginning of the list, waiting at most
+//	"ticks" (of simulated time) for one to be appended.  Returns NULL
+//	if none was.
+//----------------------------------------------------------------------
+
+void *
+BoundedSynchList::RemoveTimeout(int ticks)
+{
+    void *item = NULL;
+    IntStatus oldLevel = interrupt->SetLevel(IntOff);
+
+    if (count > 0)
+	item = Take();
+    else if (ticks > 0)
+	item = WaitForItem(ticks);
+    (void) interrupt->SetLevel(oldLevel);
+    return item;
+}
+
+//----------------------------------------------------------------------
+// BoundedSynchList::RemoveBatch
+//      Remove up to "max" items from the beginning of the list into
+//	"items", waiting if the list is empty.  Returns the number of
+//	items removed, at least one.
+//----------------------------------------------------------------------
+
+int
+BoundedSynchList::RemoveBatch(void **items, int max)
+{
+    int n = 0;
+    IntStatus oldLevel = interrupt->SetLevel(IntOff);
+
+    ASSERT(max > 0);
+    if (count == 0)
+	items[n++] = WaitForItem(0);
+    while ((n < max) && (count > 0))
+	items[n++] = Take();
+    (void) interrupt->SetLevel(oldLevel);
+    return n;
+}
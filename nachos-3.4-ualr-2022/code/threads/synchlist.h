@@ -39,4 +39,53 @@ class SynchList {
     Condition *listEmpty;	// wait in Remove if the list is empty
 };
 
+// The following class defines a "bounded synchronized list" -- like a
+// SynchList, but with room for at most "capacity" items, kept in a
+// fixed array rather than in a List, so that Append allocates nothing:
+//	1. Remove waits until the list has an item on it; TryRemove
+//	never waits, and RemoveTimeout waits for at most a given number
+//	of ticks.
+//	2. Append waits while the list is full, so that a producer cannot
+//	get arbitrarily far ahead of its consumers.
+//	3. AppendBatch and RemoveBatch move several items at once.
+//
+// An item is handed directly to a thread waiting in Remove, and a slot
+// freed by Remove is given directly to a thread waiting in Append, so
+// woken threads never have to compete for what they were woken for.
+// Items must not be NULL.
+
+class BoundedSynchList {
+  public:
+    BoundedSynchList(int capacity);	// initialize an empty list
+    ~BoundedSynchList();		// de-allocate; no one may be
+					// waiting on the list
+
+    void Append(void *item);		// append item, waiting for room
+    bool TryAppend(void *item);		// append item, or return FALSE if
+					// there is no room
+    void AppendBatch(void **items, int n);
+					// append n items, in order
+    void *Remove();			// remove the first item, waiting
+					// if the list is empty
+    void *TryRemove();			// remove the first item, or
+					// return NULL if there is none
+    void *RemoveTimeout(int ticks);	// remove the first item, waiting
+					// at most "ticks"; NULL if none came
+    int RemoveBatch(void **items, int max);
+					// remove between 1 and max items,
+					// waiting for the first; returns
+					// the number removed
+
+  private:
+    void **buffer;			// the items, in a circular array
+    int capacity;			// size of "buffer"
+    int first;				// index of the first item
+    int count;				// number of items in "buffer"
+    List *removers;			// threads waiting for an item
+    List *appenders;			// threads waiting for room
+
+    void Put(void *item);		// append, or hand to a remover
+    void *Take();			// remove, and let an appender in
+    void *WaitForItem(int ticks);	// wait in "removers"
+};
 #endif // SYNCHLIST_H
@@ -0,0 +1,148 @@
+// synchstats.cc
+//	Routines for profiling the synchronization routines: keeping
+//	the counts for each name, and printing them at the end.
+//
+//	Objects look up their counts when they are created, so that
+//	each use costs only a few additions; if profiling is off, the
+//	lookup returns NULL and nothing at all is counted.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "synchstats.h"
+#include "list.h"
+#include "system.h"
+
+bool synchProfiling = FALSE;		// set by "nachos -lp"
+
+static SynchStats *allStats = NULL;	// every name seen so far
+
+//----------------------------------------------------------------------
+// SynchStats::SynchStats
+// 	Initialize the counts for a name, to zero.  The name is copied,
+//	since the object it came from may well go away before the counts
+//	are printed.
+//----------------------------------------------------------------------
+
+SynchStats::SynchStats(const char* debugName, const char* kindName)
+{
+    name = new char[strlen(debugName) + 1];
+    strcpy(name, debugName);
+    kind = kindName;
+    uses = waits = 0;
+    waitTicks = maxWaitTicks = 0;
+    holdTicks = maxHoldTicks = 0;
+    next = NULL;
+}
+
+SynchStats::~SynchStats()
+{
+    delete [] name;
+}
+
+//----------------------------------------------------------------------
+// SynchStats::Waited
+// 	Count one use of an object, for which the calling thread had to
+//	wait from "startTicks" until now.
+//----------------------------------------------------------------------
+
+void
+SynchStats::Waited(int startTicks)
+{
+    int waited = stats->totalTicks - startTicks;
+
+    uses++;
+    waits++;
+    waitTicks += waited;
+    if (waited > maxWaitTicks)
+	maxWaitTicks = waited;
+}
+
+//----------------------------------------------------------------------
+// SynchStats::Held
+// 	Count the time a lock was held, from "startTicks" until now.
+//----------------------------------------------------------------------
+
+void
+SynchStats::Held(int startTicks)
+{
+    int held = stats->totalTicks - startTicks;
+
+    holdTicks += held;
+    if (held > maxHoldTicks)
+	maxHoldTicks = held;
+}
+
+//----------------------------------------------------------------------
+// SynchStats::Print
+// 	Print one line of counts, under the heading printed by
+//	SynchStatsPrint.
+//----------------------------------------------------------------------
+
+void
+SynchStats::Print(FILE *out)
+{
+    fprintf(out, "%-9s %-24s %8d %8d %10d %8d", kind, name, uses, waits,
+	waitTicks, maxWaitTicks);
+    if (!strcmp(kind, "lock"))			// only locks are held
+	fprintf(out, " %10d %8d", holdTicks, maxHoldTicks);
+    fprintf(out, "\n");
+}
+
+//----------------------------------------------------------------------
+// SynchStatsFind
+// 	Return the counts kept for objects of the name and kind given,
+//	creating them if this is the first; or NULL, if profiling is off.
+//----------------------------------------------------------------------
+
+SynchStats *
+SynchStatsFind(const char* debugName, const char* kindName)
+{
+    SynchStats *s;
+
+    if (!synchProfiling)
+	return NULL;
+    if (debugName == NULL)
+	debugName = "(no name)";
+    for (s = allStats; s != NULL; s = s->next)
+	if (!strcmp(s->kind, kindName) && !strcmp(s->name, debugName))
+	    return s;
+    s = new SynchStats(debugName, kindName);
+    s->next = allStats;
+    allStats = s;
+    return s;
+}
+
+//----------------------------------------------------------------------
+// SynchStatsPrint
+// 	Print the counts for every name, those with the most time spent
+//	waiting first, to the file "fileName" -- or to stdout, if it is
+//	NULL.
+//----------------------------------------------------------------------
+
+void
+SynchStatsPrint(char *fileName)
+{
+    List *sorted = new List;
+    SynchStats *s;
+    FILE *out = stdout;
+
+    if (fileName != NULL && (out = fopen(fileName, "w")) == NULL) {
+	printf("Unable to write synchronization profile to %s\n", fileName);
+	out = stdout;
+    }
+    for (s = allStats; s != NULL; s = s->next)
+	sorted->SortedInsert((void *)s, -s->waitTicks);
+
+    fprintf(out, "Synchronization (ticks):\n");
+    fprintf(out, "%-9s %-24s %8s %8s %10s %8s %10s %8s\n", "kind", "name",
+	"uses", "waits", "wait", "max", "hold", "max");
+    while ((s = (SynchStats *)sorted->Remove()) != NULL)
+	s->Print(out);
+    delete sorted;
+
+    if (out != stdout)
+	fclose(out);
+}
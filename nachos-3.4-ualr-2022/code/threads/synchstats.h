@@ -0,0 +1,63 @@
+// synchstats.h
+//	Data structures for profiling the synchronization routines.
+//
+//	When profiling is turned on (with "nachos -lp [file]"), every
+//	semaphore, lock and condition variable counts how often it is
+//	used, how often a thread had to wait for it, and for how long;
+//	locks also count how long they are held.  The counts are kept by
+//	name, so that all the objects of the same name (for instance,
+//	one lock per open file) are added together, and are printed
+//	when Nachos halts, those with the most waiting first.
+//
+//	The point is to find the places where threads queue up behind
+//	one another -- the serialization points that limit throughput.
+//	All times are in simulated ticks.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#ifndef SYNCHSTATS_H
+#define SYNCHSTATS_H
+
+#include "copyright.h"
+#include "utility.h"
+
+// The following class defines the counts kept for one name.  For a
+// lock, a "use" is an Acquire; for a semaphore, a P; for a condition
+// variable, a Wait (which always waits).
+
+class SynchStats {
+  public:
+    SynchStats(const char* debugName, const char* kindName);
+    ~SynchStats();
+
+    void Used() { uses++; }		// a use that did not wait
+    void Waited(int startTicks);	// a use that had to wait, from
+					// "startTicks" until now
+    void Held(int startTicks);		// a lock, held since "startTicks",
+					// has been released
+
+    void Print(FILE *out);		// print the counts
+
+    char *name;				// name of the objects counted here
+    const char *kind;			// "lock", "semaphore", "condition"
+    int uses;				// # of uses
+    int waits;				// # of uses that had to wait
+    int waitTicks, maxWaitTicks;	// total and longest wait
+    int holdTicks, maxHoldTicks;	// total and longest hold (locks only)
+    SynchStats *next;			// all counts are kept on one list
+};
+
+extern bool synchProfiling;		// is profiling turned on?
+
+extern SynchStats *SynchStatsFind(const char* debugName,
+					const char* kindName);
+					// the counts for the objects of
+					// this name, or NULL if profiling
+					// is off
+extern void SynchStatsPrint(char *fileName);
+					// print all the counts, to
+					// "fileName", or if NULL, stdout
+
+#endif // SYNCHSTATS_H
@@ -24,6 +24,61 @@
 					// execution stack, for detecting 
 					// stack overflows
 
+//----------------------------------------------------------------------
+// StackPoolGet, StackPoolPut
+// 	A small pool of thread stacks that have been freed, but not yet
+//	handed back to the host.  AllocBoundedArray costs a fresh host
+//	allocation plus two mprotect calls for the guard pages on either
+//	side, and DeallocBoundedArray undoes all of it; since programs
+//	tend to fork many short-lived threads with the same stack size,
+//	a stack is kept here (guard pages and all) when its thread is
+//	deleted, and given to the next thread that asks for the same size.
+//
+//	At most StackPoolSize stacks are kept; the rest are freed.
+//----------------------------------------------------------------------
+
+static int *stackPool[StackPoolSize];		// stacks ready for reuse
+static int stackPoolWords[StackPoolSize];	// their sizes, in words
+static int stackPoolCount = 0;			// # of stacks in the pool
+
+static int *
+StackPoolGet(int words)
+{
+    int *result = NULL;
+    IntStatus oldLevel = interrupt->SetLevel(IntOff);
+
+    for (int i = stackPoolCount - 1; i >= 0; i--)
+	if (stackPoolWords[i] == words) {
+	    result = stackPool[i];
+	    stackPoolCount--;
+	    stackPool[i] = stackPool[stackPoolCount];
+	    stackPoolWords[i] = stackPoolWords[stackPoolCount];
+	    break;
+	}
+    (void) interrupt->SetLevel(oldLevel);
+
+    if (result == NULL)
+	result = (int *) AllocBoundedArray(words * sizeof(_int));
+    return result;
+}
+
+static void
+StackPoolPut(int *stack, int words)
+{
+    IntStatus oldLevel = interrupt->SetLevel(IntOff);
+
+    if (stackPoolCount < StackPoolSize) {
+	stackPool[stackPoolCount] = stack;
+	stackPoolWords[stackPoolCount] = words;
+	stackPoolCount++;
+	stack = NULL;
+    }
+    (void) interrupt->SetLevel(oldLevel);
+
+    if (stack != NULL)
+	DeallocBoundedArray((char *) stack, words * sizeof(_int));
+}
+
 //----------------------------------------------------------------------
 // Thread::Thread
 // 	Initialize a thread control block, so that we can then call
@@ -37,6 +92,7 @@ Thread::Thread(const char* threadName)
     name = (char*)threadName;
     stackTop = NULL;
     stack = NULL;
+    stackSize = StackSize;
     status = JUST_CREATED;
 #ifdef USER_PROGRAM
     space = NULL;
@@ -61,7 +117,25 @@ Thread::~Thread()
 
     ASSERT(this != currentThread);
     if (stack != NULL)
-		DeallocBoundedArray((char *) stack, StackSize * sizeof(_int));
+		StackPoolPut(stack, stackSize);
+}
+
+//----------------------------------------------------------------------
+// Thread::SetStackSize
+// 	Give the thread an execution stack of "words" words, instead of
+//	the default StackSize.  Threads that recurse deeply need more;
+//	threads that only run a small procedure can get by with less.
+//
+//	Must be called before Fork, since that is when the stack
+//	is allocated.
+//----------------------------------------------------------------------
+
+void
+Thread::SetStackSize(int words)
+{
+    ASSERT((stack == NULL) && (status == JUST_CREATED));
+    ASSERT(words >= 128);		// room for the initial stack frame
+    stackSize = words;
 }
 
 //----------------------------------------------------------------------
@@ -123,7 +197,7 @@ Thread::CheckOverflow()
 {
     if (stack != NULL)
 #ifdef HOST_SNAKE			// Stacks grow upward on the Snakes
-	ASSERT((unsigned int)stack[StackSize - 1] == STACK_FENCEPOST);
+	ASSERT((unsigned int)stack[stackSize - 1] == STACK_FENCEPOST);
 #else
 	ASSERT((unsigned int)*stack == STACK_FENCEPOST);
 #endif
@@ -257,19 +331,19 @@ void ThreadPrint(_int arg){ Thread *t = (Thread *)arg; t->Print(); }
 void
 Thread::StackAllocate (VoidFunctionPtr func, _int arg)
 {
-    stack = (int *) AllocBoundedArray(StackSize * sizeof(_int));
+    stack = StackPoolGet(stackSize);
 
 #ifdef HOST_SNAKE
     // HP stack works from low addresses to high addresses
     stackTop = stack + 16;	// HP requires 64-byte frame marker
-    stack[StackSize - 1] = STACK_FENCEPOST;
+    stack[stackSize - 1] = STACK_FENCEPOST;
 #else
     // i386 & MIPS & SPARC & ALPHA stack works from high addresses to low addresses
 #ifdef HOST_SPARC
     // SPARC stack must contains at least 1 activation record to start with.
-    stackTop = stack + StackSize - 96;
+    stackTop = stack + stackSize - 96;
 #else  // HOST_MIPS  || HOST_i386 || HOST_ALPHA
-    stackTop = stack + StackSize - 4;	// -4 to be on the safe side!
+    stackTop = stack + stackSize - 4;	// -4 to be on the safe side!
 #ifdef HOST_i386
     // the 80386 passes the return address on the stack.  In order for
     // SWITCH() to go to ThreadRoot when we switch to this thread, the
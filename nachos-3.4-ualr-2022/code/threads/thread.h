@@ -56,6 +56,10 @@
 // WATCH OUT IF THIS ISN'T BIG ENOUGH!!!!!
 #define StackSize	(sizeof(_int) * 1024)	// in words
 
+// Number of freed stacks kept around for reuse by later Forks, instead
+// of handing them back to the host (see Thread::StackAllocate).
+#define StackPoolSize	16
+
 
 // Thread state
 enum ThreadStatus { JUST_CREATED, RUNNING, READY, BLOCKED };
@@ -99,6 +103,9 @@ class Thread {
     
     void CheckOverflow();   			// Check if thread has 
 						// overflowed its stack
+    void SetStackSize(int words);		// Use a stack of "words" words
+						// instead of StackSize; call
+						// before Fork
     void setStatus(ThreadStatus st) { status = st; }
     char* getName() { return (name); }
     void Print() { printf("%s, ", name); }
@@ -109,6 +116,7 @@ class Thread {
     int* stack; 	 		// Bottom of the stack 
 					// NULL if this is the main thread
 					// (If NULL, don't deallocate stack)
+    int stackSize;			// size of "stack", in words
     ThreadStatus status;		// ready, running or blocked
     char* name;
 
@@ -0,0 +1,149 @@
+// threadbench.cc
+//	Benchmarks for the hottest paths in the thread system: the
+//	context switch (SWITCH, Scheduler::Run and Thread::Yield),
+//	a semaphore hand-off between two threads, thread creation
+//	and destruction, and (with USER_PROGRAM) the extra work done
+//	to switch between threads running user programs.
+//
+//	Everything is timed on the host's clock, not in simulated ticks,
+//	since it is the speed of Nachos itself that we are measuring.
+//	Results are printed one per line, in the form
+//
+//		bench <name> <operations> <nanoseconds per operation>
+//
+//	so that a script can collect them and compare against an
+//	earlier run.
+//
+//	Run with "nachos -tb [iterations]".
+
+#include "copyright.h"
+#include "system.h"
+#include "synch.h"
+
+#define DefaultBenchIterations	10000
+
+static Semaphore *ping;		// semaphore ping-pong, one per direction
+static Semaphore *pong;
+
+//----------------------------------------------------------------------
+// BenchReport
+// 	Print the result of one benchmark.
+//
+//	"name" identifies the benchmark
+//	"ops" is the number of operations timed
+//	"elapsed" is the host time they took, in nanoseconds
+//----------------------------------------------------------------------
+
+static void
+BenchReport(const char *name, int ops, double elapsed)
+{
+    printf("bench %s %d %.1f\n", name, ops, elapsed / ops);
+    fflush(stdout);
+}
+
+//----------------------------------------------------------------------
+// YieldLoop, PongLoop, UserYieldLoop, Nop
+// 	The procedures run by the threads forked by the benchmarks.
+//	"n" is the number of iterations.
+//----------------------------------------------------------------------
+
+static void
+YieldLoop(_int n)
+{
+    for (int i = 0; i < n; i++)
+	currentThread->Yield();
+}
+
+static void
+PongLoop(_int n)
+{
+    for (int i = 0; i < n; i++) {
+	ping->P();
+	pong->V();
+    }
+}
+
+#ifdef USER_PROGRAM
+static void
+UserYieldLoop(_int n)
+{
+    for (int i = 0; i < n; i++) {
+	currentThread->SaveUserState();
+	currentThread->Yield();
+	currentThread->RestoreUserState();
+    }
+}
+#endif
+
+static void
+Nop(_int n)
+{
+}
+
+//----------------------------------------------------------------------
+// ThreadBench
+// 	Run each of the benchmarks "iterations" times, and print
+//	the results.
+//
+//	yield		-- two threads Yield back and forth; one context
+//			   switch per Yield
+//	pingpong	-- two threads hand a pair of semaphores back
+//			   and forth; two context switches per round trip
+//	forkfinish	-- fork a thread that does nothing, and run it
+//			   until it finishes and is deleted
+//	userswitch	-- as yield, but also saving and restoring the
+//			   user-level registers, as Scheduler::Run does for
+//			   a thread with an address space (the page table
+//			   switch is not included, since there is no user
+//			   program loaded)
+//----------------------------------------------------------------------
+
+void
+ThreadBench(int iterations)
+{
+    Thread *t;
+    double start;
+    int i;
+
+    if (iterations <= 0)
+	iterations = DefaultBenchIterations;
+    DEBUG('t', "Entering ThreadBench, %d iterations\n", iterations);
+
+    t = new Thread("bench yield");
+    t->Fork(YieldLoop, iterations);
+    start = HostTime();
+    YieldLoop(iterations);
+    BenchReport("yield", 2 * iterations, HostTime() - start);
+    currentThread->Yield();		// let the partner finish
+
+    ping = new Semaphore("bench ping", 0);
+    pong = new Semaphore("bench pong", 0);
+    t = new Thread("bench pong");
+    t->Fork(PongLoop, iterations);
+    start = HostTime();
+    for (i = 0; i < iterations; i++) {
+	ping->V();
+	pong->P();
+    }
+    BenchReport("pingpong", iterations, HostTime() - start);
+    currentThread->Yield();
+    delete ping;
+    delete pong;
+
+    start = HostTime();
+    for (i = 0; i < iterations; i++) {
+	t = new Thread("bench nop");
+	t->Fork(Nop, 0);
+	currentThread->Yield();		// run it to completion
+    }
+    BenchReport("forkfinish", iterations, HostTime() - start);
+
+#ifdef USER_PROGRAM
+    t = new Thread("bench user");
+    t->Fork(UserYieldLoop, iterations);
+    start = HostTime();
+    UserYieldLoop(iterations);
+    BenchReport("userswitch", 2 * iterations, HostTime() - start);
+    currentThread->Yield();
+#endif
+}
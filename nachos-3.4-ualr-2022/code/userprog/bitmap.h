@@ -22,6 +22,7 @@
 // Definitions helpful for representing a bitmap as an array of integers
 #define BitsInByte 	8
 #define BitsInWord 	32
+#define AllOnes		(~0u)		// a word with every bit set
 
 // The following class defines a "bitmap" -- an array of bits,
 // each of which can be independently set, cleared, and tested.
@@ -43,6 +44,10 @@ class BitMap {
     int Find();            	// Return the # of a clear bit, and as a side
 				// effect, set the bit. 
 				// If no bits are clear, return -1.
+    int FindContiguous(int count, int start, int end);
+				// Find "count" clear bits in a row,
+				// between "start" and "end", and set
+				// them; return the first, or -1
     int NumClear();		// Return the number of clear bits
 
     void Print();		// Print contents of bitmap
@@ -59,6 +64,17 @@ class BitMap {
 					//  multiple of the number of bits in
 					//  a word)
     unsigned int *map;			// bit storage
+
+    // Kept alongside the bits, to make searching them quick
+    int numFullWords;			// number of words of "full"
+    unsigned int *full;			// bit "w" is set if word "w" of
+					// "map" has every bit set
+    int numClear;			// number of clear bits
+    int hint;				// first word that may have a
+					// clear bit; every word before it
+					// is full
+
+    void Recount();			// rebuild the above from "map"
 };
 
 #endif // BITMAP_H